@@ -1,4 +1,6 @@
 #version 330 core
+// The shader loader defines one flag per texture bound by the material (HAS_BASE_COLOR_MAP, HAS_METALLIC_ROUGHNESS_MAP,
+// HAS_NORMAL_MAP, HAS_OCCLUSION_MAP, HAS_EMISSIVE_MAP) and ALPHA_MASK, so a variant only samples what its materials have
 out vec4 frag_color;
 
 in vec3 current_pos;
@@ -6,26 +8,71 @@ in vec3 normal;
 in vec2 tex_coords;
 in vec3 tangent;
 
+#ifdef HAS_BASE_COLOR_MAP
 uniform sampler2D base_color_texture0;
+#endif
+#ifdef HAS_METALLIC_ROUGHNESS_MAP
 uniform sampler2D metallic_roughness_texture0;
+#endif
+#ifdef HAS_NORMAL_MAP
+uniform sampler2D normal_texture0;
+#endif
+#ifdef HAS_OCCLUSION_MAP
+uniform sampler2D occlusion_texture0;
+#endif
+#ifdef HAS_EMISSIVE_MAP
+uniform sampler2D emissive_texture0;
+#endif
+#ifdef ALPHA_MASK
+uniform float alpha_cutoff;
+#endif
 uniform vec4 light_color;
 uniform vec3 cam_pos;
 
 void main() {
+#ifdef HAS_BASE_COLOR_MAP
+	vec4 base_color = texture(base_color_texture0, tex_coords);
+#else
+	vec4 base_color = vec4(1.0f);
+#endif
+
+#ifdef ALPHA_MASK
+	if (base_color.a < alpha_cutoff) discard;
+#endif
+
 	// ambient lighting
 	float ambient = 0.20f;
+#ifdef HAS_OCCLUSION_MAP
+	ambient *= texture(occlusion_texture0, tex_coords).r;
+#endif
 
 	// diffuse lighting
 	vec3 normal = normalize(normal);
+#ifdef HAS_NORMAL_MAP
+	// Only x and y are stored by the two channels formats (BC5), z is rebuilt. The tangents carry no handedness
+	vec3 tangent = normalize(tangent - normal * dot(normal, tangent));
+	vec2 normal_xy = texture(normal_texture0, tex_coords).rg * 2.0f - 1.0f;
+	vec3 tangent_normal = vec3(normal_xy, sqrt(max(1.0f - dot(normal_xy, normal_xy), 0.0f)));
+	normal = normalize(mat3(tangent, cross(normal, tangent), normal) * tangent_normal);
+#endif
 	vec3 light_direction = normalize(vec3(1.0f, 1.0f, 0.0f));
 	float diffuse = max(dot(normal, light_direction), 0.0f);
 
-	// specular lighting
+	vec4 color = base_color * (diffuse + ambient);
+
+	// specular lighting, weighted by the map: without one it is zero, as with the placeholder texel
+#ifdef HAS_METALLIC_ROUGHNESS_MAP
 	float specular_light = 0.50f;
 	vec3 view_direction = normalize(cam_pos - current_pos);
 	vec3 reflection_direction = reflect(-light_direction, normal);
 	float spec_amount = pow(max(dot(view_direction, reflection_direction), 0.0f), 16);
 	float specular = spec_amount * specular_light;
+	color += texture(metallic_roughness_texture0, tex_coords).r * specular;
+#endif
+
+	frag_color = color * light_color;
 
-	frag_color = (texture(base_color_texture0, tex_coords) * (diffuse + ambient) + texture(metallic_roughness_texture0, tex_coords).r * specular) * light_color;
+#ifdef HAS_EMISSIVE_MAP
+	frag_color.rgb += texture(emissive_texture0, tex_coords).rgb;
+#endif
 }
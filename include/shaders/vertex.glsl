@@ -1,19 +1,41 @@
 #version 330 core
+// INDIRECT reads the transform of each mesh from a buffer texture indexed by the draw id,
+// INSTANCED applies a per-instance transform on top of the mesh one
 layout (location = 0) in vec3 a_pos;
 layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec2 a_tex_coords;
 layout (location = 3) in vec3 a_tangent;
+#if defined(INDIRECT)
+layout (location = 4) in uint a_draw_id;
+#elif defined(INSTANCED)
+layout (location = 5) in mat4 a_instance;
+#endif
 
 out vec3 current_pos;
 out vec3 normal;
 out vec2 tex_coords;
 out vec3 tangent;
 
+#ifdef INDIRECT
+// One row-major mat4 per mesh, stored as four RGBA32F texels
+uniform samplerBuffer mesh_transforms;
+#else
 uniform mat4 transform;
+#endif
 uniform mat4 camera_matrix;
 
 void main() {
+#if defined(INDIRECT)
+	int base = int(a_draw_id) * 4;
+	// The rows become the columns of the constructed matrix, so it holds the transpose and multiplies from the left
+	mat4 transform = mat4(texelFetch(mesh_transforms, base), texelFetch(mesh_transforms, base + 1), texelFetch(mesh_transforms, base + 2), texelFetch(mesh_transforms, base + 3));
+	current_pos = vec3(vec4(a_pos, 1.0f) * transform);
+#elif defined(INSTANCED)
+	// The instance rows become the columns of a_instance, so it holds the transpose and multiplies from the left
+	current_pos = vec3((transform * vec4(a_pos, 1.0f)) * a_instance);
+#else
 	current_pos = vec3(transform * vec4(a_pos, 1.0f));
+#endif
 	normal = a_normal;
 	tex_coords = a_tex_coords;
     tangent = a_tangent;
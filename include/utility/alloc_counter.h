@@ -0,0 +1,70 @@
+#ifndef _ALLOC_COUNTER_H_
+#define _ALLOC_COUNTER_H_
+
+#include <stdlib.h>
+#include "./utils.h"
+
+// Frames allowed to allocate before the steady state is enforced
+#define ALLOC_WARM_UP_FRAMES 3
+
+#ifdef _ALLOC_COUNTER_
+
+// The allocator entry points are wrapped at link time (-Wl,--wrap=malloc,...), see the debug target of the Makefile,
+// so that every heap allocation done by this program, but not by the shared libraries, goes through the counter.
+// Each thread counts its own, the workers decoding textures or writing the caches allocate by design and must not
+// show up in the frames of the render thread
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void* __real_aligned_alloc(size_t alignment, size_t size);
+
+static _Thread_local unsigned long long int allocations_count = 0;
+
+void* __wrap_malloc(size_t size) {
+    allocations_count++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    allocations_count++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    allocations_count++;
+    return __real_realloc(ptr, size);
+}
+
+void* __wrap_aligned_alloc(size_t alignment, size_t size) {
+    allocations_count++;
+    return __real_aligned_alloc(alignment, size);
+}
+
+// Allocations done so far by the calling thread
+unsigned long long int get_allocations_count(void) {
+    return allocations_count;
+}
+
+// Report the allocations done during the frame and fail if the steady state allocates
+void check_frame_allocations(unsigned long long int frame, unsigned long long int frame_start_count) {
+    unsigned long long int frame_allocations = get_allocations_count() - frame_start_count;
+
+    if (frame_allocations == 0) return;
+
+    if (frame < ALLOC_WARM_UP_FRAMES) {
+        debug_info("frame %llu: %llu heap allocations (warm-up)\n", frame, frame_allocations);
+        return;
+    }
+
+    error_info("frame %llu: %llu heap allocations after the warm-up, the render loop must not allocate\n", frame, frame_allocations);
+    exit(EXIT_FAILURE);
+}
+
+#else
+
+#define get_allocations_count() 0ULL
+#define check_frame_allocations(frame, frame_start_count) ((void) (frame), (void) (frame_start_count))
+
+#endif //_ALLOC_COUNTER_
+
+#endif //_ALLOC_COUNTER_H_
@@ -0,0 +1,138 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include "./types.h"
+
+#define TRUE 1
+#define FALSE 0
+#define FRAME_ARENA_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 16
+#define ARENA_ALIGN(size) (((size) + (ARENA_ALIGNMENT - 1)) & ~((size_t) (ARENA_ALIGNMENT - 1)))
+
+// Linear allocator: allocations bump an offset and are all released together by arena_reset.
+// Requests that do not fit are served from spill blocks and the arena grows to the high-water mark on the next reset,
+// so after the first frames the arena reaches its steady-state size and no longer touches the heap.
+// NOTE: the arena is not thread-safe, the frame arena must only be used from the render thread
+typedef struct Arena {
+    unsigned char* base;
+    size_t capacity;
+    size_t offset;
+    size_t high_water_mark;
+    size_t used;
+    void** spills;
+    unsigned int spills_count;
+    unsigned int overflow_count;
+} Arena;
+
+/* DECLARATIONS */
+
+Arena init_arena(size_t capacity);
+void* arena_alloc(Arena* arena, size_t size);
+bool arena_owns(Arena* arena, const void* ptr);
+void arena_reset(Arena* arena);
+void deallocate_arena(Arena* arena);
+void* frame_arena_alloc(size_t size);
+bool frame_arena_owns(const void* ptr);
+void frame_arena_reset(void);
+Arena* get_frame_arena(void);
+
+/* ----------------------------------------------- */
+
+static Arena frame_arena = {0};
+
+Arena init_arena(size_t capacity) {
+    Arena arena = {0};
+    arena.capacity = ARENA_ALIGN(capacity);
+    arena.base = (unsigned char*) aligned_alloc(ARENA_ALIGNMENT, arena.capacity);
+    return arena;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = ARENA_ALIGN(size);
+    arena -> used += size;
+    if (arena -> used > arena -> high_water_mark) arena -> high_water_mark = arena -> used;
+
+    if (arena -> offset + size <= arena -> capacity) {
+        void* ptr = arena -> base + arena -> offset;
+        arena -> offset += size;
+        return ptr;
+    }
+
+    // Overflow: serve the request from a spill block, released on the next reset
+    arena -> overflow_count++;
+    arena -> spills = (void**) realloc(arena -> spills, (arena -> spills_count + 1) * sizeof(void*));
+    arena -> spills[arena -> spills_count] = aligned_alloc(ARENA_ALIGNMENT, size);
+
+    return arena -> spills[(arena -> spills_count)++];
+}
+
+bool arena_owns(Arena* arena, const void* ptr) {
+    if (ptr == NULL) return FALSE;
+
+    const unsigned char* p = (const unsigned char*) ptr;
+    if (arena -> base != NULL && p >= arena -> base && p < arena -> base + arena -> capacity) return TRUE;
+
+    for (unsigned int i = 0; i < arena -> spills_count; ++i) {
+        if (arena -> spills[i] == ptr) return TRUE;
+    }
+
+    return FALSE;
+}
+
+void arena_reset(Arena* arena) {
+    for (unsigned int i = 0; i < arena -> spills_count; ++i) {
+        free(arena -> spills[i]);
+    }
+
+    free(arena -> spills);
+    arena -> spills = NULL;
+    arena -> spills_count = 0;
+
+    // Grow to fit the high-water mark, so that the overflow does not happen again
+    if (arena -> overflow_count) {
+        printf("ARENA::OVERFLOW: %u allocations did not fit in %zu bytes, growing to %zu bytes\n", arena -> overflow_count, arena -> capacity, ARENA_ALIGN(arena -> high_water_mark));
+        free(arena -> base);
+        *arena = (Arena) { .high_water_mark = arena -> high_water_mark };
+        Arena grown = init_arena(arena -> high_water_mark);
+        arena -> base = grown.base;
+        arena -> capacity = grown.capacity;
+    }
+
+    arena -> offset = 0;
+    arena -> used = 0;
+
+    return;
+}
+
+void deallocate_arena(Arena* arena) {
+    arena_reset(arena);
+    free(arena -> base);
+    *arena = (Arena) {0};
+    return;
+}
+
+/* FRAME ARENA */
+
+void* frame_arena_alloc(size_t size) {
+    if (frame_arena.base == NULL) frame_arena = init_arena(FRAME_ARENA_SIZE);
+    return arena_alloc(&frame_arena, size);
+}
+
+bool frame_arena_owns(const void* ptr) {
+    return arena_owns(&frame_arena, ptr);
+}
+
+// Release every temporary allocated during the frame
+void frame_arena_reset(void) {
+    arena_reset(&frame_arena);
+    return;
+}
+
+Arena* get_frame_arena(void) {
+    return &frame_arena;
+}
+
+#endif //_ARENA_H_
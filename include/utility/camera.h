@@ -6,17 +6,15 @@
 #include "./types.h"
 #include "./GLFW/glfw3.h"
 
-Camera init_camera(Vector camera_pos, Vector camera_front, Vector camera_up, float camera_speed) {
+Camera init_camera(Vec3 camera_pos, Vec3 camera_front, Vec3 camera_up, float camera_speed) {
     Camera camera = {.camera_pos = camera_pos, .camera_front = camera_front, .camera_up = camera_up, .camera_speed = camera_speed};
     return camera;
 }
 
-void update_camera_front(Camera camera, float* mouse_pos) {
+void update_camera_front(Camera* camera, float* mouse_pos) {
     float yaw = mouse_pos[0];
     float pitch = mouse_pos[1];
-    Vector direction = VEC(cosf(deg_to_rad(yaw)) * cosf(deg_to_rad(pitch)), sinf(deg_to_rad(pitch)), sinf(deg_to_rad(yaw)) * cosf(deg_to_rad(pitch)));
-    normalize_vector(direction, &(camera.camera_front));
-    DEALLOCATE_MATRICES(direction);
+    camera -> camera_front = vec3_normalize(vec3(cosf(deg_to_rad(yaw)) * cosf(deg_to_rad(pitch)), sinf(deg_to_rad(pitch)), sinf(deg_to_rad(yaw)) * cosf(deg_to_rad(pitch))));
     return;
 }
 
@@ -37,44 +35,34 @@ void update_camera_speed(Camera* camera, unsigned char reset) {
     return;
 }
 
-Matrix look_at(Camera camera) {
+Mat4 mat4_look_at(Vec3 camera_pos, Vec3 camera_front, Vec3 camera_up) {
     // Retrieve the Right, Direction and Up vectors
-    Vector camera_target = alloc_vector(0.0f, 1);
-    SUM_MATRICES(&camera_target, camera.camera_front, camera.camera_pos);
-    Vector camera_direction = alloc_vector(0.0f, 1);
-    SUM_MATRICES(&camera_direction, camera.camera_pos, negate(camera_target));
-    normalize_vector(camera_direction, &camera_direction);
-    Vector camera_right = cross_product(camera.camera_up, camera_direction);
-    normalize_vector(camera_right, &camera_right);
-    Vector camera_up = cross_product(camera_direction, camera_right);
+    Vec3 camera_target = vec3_sum(camera_front, camera_pos);
+    Vec3 camera_direction = vec3_normalize(vec3_sum(camera_pos, vec3_negate(camera_target)));
+    Vec3 camera_right = vec3_normalize(vec3_cross(camera_up, camera_direction));
+    Vec3 up = vec3_cross(camera_direction, camera_right);
 
     // Add them as rows of the first matrix
-    Matrix dir_matrix = create_identity_matrix(4);
+    Mat4 dir_matrix = mat4_identity();
 
     for (unsigned int i = 0; i < 3; ++i) {
-        MAT_INDEX(dir_matrix, 0, i) = VEC_INDEX(camera_right, i);
-        MAT_INDEX(dir_matrix, 1, i) = VEC_INDEX(camera_up, i);
-        MAT_INDEX(dir_matrix, 2, i) = VEC_INDEX(camera_direction, i);
+        MAT4_INDEX(dir_matrix, 0, i) = VEC_INDEX(camera_right, i);
+        MAT4_INDEX(dir_matrix, 1, i) = VEC_INDEX(up, i);
+        MAT4_INDEX(dir_matrix, 2, i) = VEC_INDEX(camera_direction, i);
     }
 
     // Create the position matrix
-    Matrix pos_matrix = create_identity_matrix(4);
+    Mat4 pos_matrix = mat4_identity();
 
     for (unsigned int i = 0; i < 3; ++i) {
-        MAT_INDEX(pos_matrix, i, 3) = -VEC_INDEX(camera.camera_pos, i);
+        MAT4_INDEX(pos_matrix, i, 3) = -VEC_INDEX(camera_pos, i);
     }
 
-    Matrix look_at_mat = alloc_matrix(0.0f, 1, 1);
-    DOT_PRODUCT_MATRIX(&look_at_mat, dir_matrix, pos_matrix);
-    DEALLOCATE_MATRICES(dir_matrix, pos_matrix, camera_direction, camera_target);
-    gc_dispose();
-
-    return look_at_mat;
+    return mat4_mul(dir_matrix, pos_matrix);
 }
 
-void deallocate_camera(Camera camera) {
-    DEALLOCATE_MATRICES(camera.camera_pos, camera.camera_front, camera.camera_up);
-    return;
+Matrix look_at(Camera camera) {
+    return matrix_from_mat4(mat4_look_at(camera.camera_pos, camera.camera_front, camera.camera_up));
 }
 
 #endif //_CAMERA_H_
@@ -0,0 +1,213 @@
+#ifndef _CONVERT_H_
+#define _CONVERT_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include "./utils.h"
+#include "./simd.h"
+#include "../../libs/gltf_header.h"
+
+// Bulk conversion of glTF accessor components to float.
+// Normalized integers follow the glTF rules: unsigned c / max, signed max(c / max, -1).
+
+// NOTE: byte_lengths from the decoder is indexed by the glTF codes (which skip 5124), not by ComponentType
+static const unsigned char component_sizes[] = { sizeof(char), sizeof(unsigned char), sizeof(short int), sizeof(unsigned short int), sizeof(unsigned int), sizeof(float) };
+
+/* DECLARATIONS */
+
+void convert_u8_to_float(const unsigned char* src, float* dest, size_t count, float scale);
+void convert_s8_to_float(const signed char* src, float* dest, size_t count, float scale, float min);
+void convert_u16_to_float(const unsigned short int* src, float* dest, size_t count, float scale);
+void convert_s16_to_float(const short int* src, float* dest, size_t count, float scale, float min);
+void convert_u32_to_float(const unsigned int* src, float* dest, size_t count);
+void convert_components(const void* src, ComponentType component_type, float* dest, size_t count, bool normalized);
+const void* get_contiguous_data(ArrayExtended arr_ext);
+float* convert_attribute(ArrayExtended arr_ext, bool normalized);
+
+/* ----------------------------------------------- */
+
+void convert_u8_to_float(const unsigned char* src, float* dest, size_t count, float scale) {
+    size_t i = 0;
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+    __m128i zero = _mm_setzero_si128();
+    __m128 scale_v = _mm_set1_ps(scale);
+    for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale_v));
+        _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale_v));
+        _mm_storeu_ps(dest + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale_v));
+        _mm_storeu_ps(dest + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale_v));
+    }
+#elif defined(_SIMD_NEON_)
+    float32x4_t scale_v = vdupq_n_f32(scale);
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t words = vmovl_u8(vld1_u8(src + i));
+        vst1q_f32(dest + i, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(words))), scale_v));
+        vst1q_f32(dest + i + 4, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(words))), scale_v));
+    }
+#endif
+    for (; i < count; ++i) dest[i] = src[i] * scale;
+    return;
+}
+
+void convert_s8_to_float(const signed char* src, float* dest, size_t count, float scale, float min) {
+    size_t i = 0;
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+    __m128 scale_v = _mm_set1_ps(scale);
+    __m128 min_v = _mm_set1_ps(min);
+    for (; i + 16 <= count; i += 16) {
+        // Duplicating each byte into the high half and shifting back arithmetically sign-extends it
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i lo = _mm_unpacklo_epi8(bytes, bytes);
+        __m128i hi = _mm_unpackhi_epi8(bytes, bytes);
+        _mm_storeu_ps(dest + i, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 24)), scale_v), min_v));
+        _mm_storeu_ps(dest + i + 4, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 24)), scale_v), min_v));
+        _mm_storeu_ps(dest + i + 8, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 24)), scale_v), min_v));
+        _mm_storeu_ps(dest + i + 12, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 24)), scale_v), min_v));
+    }
+#elif defined(_SIMD_NEON_)
+    float32x4_t scale_v = vdupq_n_f32(scale);
+    float32x4_t min_v = vdupq_n_f32(min);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t words = vmovl_s8(vld1_s8(src + i));
+        vst1q_f32(dest + i, vmaxq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(words))), scale_v), min_v));
+        vst1q_f32(dest + i + 4, vmaxq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(words))), scale_v), min_v));
+    }
+#endif
+    for (; i < count; ++i) {
+        float value = src[i] * scale;
+        dest[i] = value < min ? min : value;
+    }
+    return;
+}
+
+void convert_u16_to_float(const unsigned short int* src, float* dest, size_t count, float scale) {
+    size_t i = 0;
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+    __m128i zero = _mm_setzero_si128();
+    __m128 scale_v = _mm_set1_ps(scale);
+    for (; i + 8 <= count; i += 8) {
+        __m128i words = _mm_loadu_si128((const __m128i*) (src + i));
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)), scale_v));
+        _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero)), scale_v));
+    }
+#elif defined(_SIMD_NEON_)
+    float32x4_t scale_v = vdupq_n_f32(scale);
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t words = vld1q_u16(src + i);
+        vst1q_f32(dest + i, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(words))), scale_v));
+        vst1q_f32(dest + i + 4, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(words))), scale_v));
+    }
+#endif
+    for (; i < count; ++i) dest[i] = src[i] * scale;
+    return;
+}
+
+void convert_s16_to_float(const short int* src, float* dest, size_t count, float scale, float min) {
+    size_t i = 0;
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+    __m128 scale_v = _mm_set1_ps(scale);
+    __m128 min_v = _mm_set1_ps(min);
+    for (; i + 8 <= count; i += 8) {
+        __m128i words = _mm_loadu_si128((const __m128i*) (src + i));
+        _mm_storeu_ps(dest + i, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16)), scale_v), min_v));
+        _mm_storeu_ps(dest + i + 4, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16)), scale_v), min_v));
+    }
+#elif defined(_SIMD_NEON_)
+    float32x4_t scale_v = vdupq_n_f32(scale);
+    float32x4_t min_v = vdupq_n_f32(min);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t words = vld1q_s16(src + i);
+        vst1q_f32(dest + i, vmaxq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(words))), scale_v), min_v));
+        vst1q_f32(dest + i + 4, vmaxq_f32(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(words))), scale_v), min_v));
+    }
+#endif
+    for (; i < count; ++i) {
+        float value = src[i] * scale;
+        dest[i] = value < min ? min : value;
+    }
+    return;
+}
+
+// glTF has no normalized UNSIGNED_INT attributes, so these are only widened
+void convert_u32_to_float(const unsigned int* src, float* dest, size_t count) {
+    size_t i = 0;
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+    // SSE2 only converts signed integers: the value is rebuilt from its two 16 bit halves, both exact in float
+    __m128i low_mask = _mm_set1_epi32(0xFFFF);
+    __m128 high_scale = _mm_set1_ps(65536.0f);
+    for (; i + 4 <= count; i += 4) {
+        __m128i values = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128 high = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(values, 16)), high_scale);
+        __m128 low = _mm_cvtepi32_ps(_mm_and_si128(values, low_mask));
+        _mm_storeu_ps(dest + i, _mm_add_ps(high, low));
+    }
+#elif defined(_SIMD_NEON_)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dest + i, vcvtq_f32_u32(vld1q_u32(src + i)));
+    }
+#endif
+    for (; i < count; ++i) dest[i] = (float) src[i];
+    return;
+}
+
+void convert_components(const void* src, ComponentType component_type, float* dest, size_t count, bool normalized) {
+    switch (component_type) {
+        case BYTE:
+            convert_s8_to_float((const signed char*) src, dest, count, normalized ? 1.0f / 127.0f : 1.0f, normalized ? -1.0f : -128.0f);
+            break;
+        case UNSIGNED_BYTE:
+            convert_u8_to_float((const unsigned char*) src, dest, count, normalized ? 1.0f / 255.0f : 1.0f);
+            break;
+        case SHORT:
+            convert_s16_to_float((const short int*) src, dest, count, normalized ? 1.0f / 32767.0f : 1.0f, normalized ? -1.0f : -32768.0f);
+            break;
+        case UNSIGNED_SHORT:
+            convert_u16_to_float((const unsigned short int*) src, dest, count, normalized ? 1.0f / 65535.0f : 1.0f);
+            break;
+        case UNSIGNED_INT:
+            convert_u32_to_float((const unsigned int*) src, dest, count);
+            break;
+        case FLOAT:
+            memcpy(dest, src, count * sizeof(float));
+            break;
+    }
+    return;
+}
+
+// Returns the first element when the decoder stored every element back to back, NULL otherwise
+const void* get_contiguous_data(ArrayExtended arr_ext) {
+    if (arr_ext.arr.count == 0) return NULL;
+
+    size_t stride = component_sizes[arr_ext.component_type] * elements_count[arr_ext.data_type];
+    const unsigned char* first = GET_ELEMENT(const unsigned char*, arr_ext.arr, 0);
+    for (unsigned int i = 1; i < arr_ext.arr.count; ++i) {
+        if (GET_ELEMENT(const unsigned char*, arr_ext.arr, i) != first + i * stride) return NULL;
+    }
+
+    return first;
+}
+
+// Converts the whole accessor to tightly packed floats with a single allocation
+float* convert_attribute(ArrayExtended arr_ext, bool normalized) {
+    if (arr_ext.arr.count == 0) return NULL;
+
+    unsigned int components = elements_count[arr_ext.data_type];
+    float* dest = (float*) malloc(arr_ext.arr.count * components * sizeof(float));
+
+    const void* data = get_contiguous_data(arr_ext);
+    if (data != NULL) {
+        convert_components(data, arr_ext.component_type, dest, (size_t) arr_ext.arr.count * components, normalized);
+        return dest;
+    }
+
+    for (unsigned int i = 0; i < arr_ext.arr.count; ++i) {
+        convert_components(GET_ELEMENT(void*, arr_ext.arr, i), arr_ext.component_type, dest + i * components, components, normalized);
+    }
+
+    return dest;
+}
+
+#endif //_CONVERT_H_
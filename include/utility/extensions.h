@@ -0,0 +1,86 @@
+#ifndef _EXTENSIONS_H_
+#define _EXTENSIONS_H_
+
+#include "../glad/glad.h"
+#include "./GLFW/glfw3.h"
+#include "./utils.h"
+
+// glad is generated for the OpenGL 3.3 core profile, the newer entry points are loaded here when the driver exposes them
+
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+int GLAD_GL_ARB_multi_draw_indirect = 0;
+int GLAD_GL_EXT_texture_compression_s3tc = 0;
+int GLAD_GL_ARB_get_program_binary = 0;
+int GLAD_GL_KHR_parallel_shader_compile = 0;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect = NULL;
+PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC glad_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri = NULL;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glad_glMaxShaderCompilerThreadsKHR = NULL;
+#define glMultiDrawElementsIndirect glad_glMultiDrawElementsIndirect
+#define glGetProgramBinary glad_glGetProgramBinary
+#define glProgramBinary glad_glProgramBinary
+#define glProgramParameteri glad_glProgramParameteri
+#define glMaxShaderCompilerThreadsKHR glad_glMaxShaderCompilerThreadsKHR
+
+static bool has_gl_version(int major, int minor) {
+    int context_major = 0;
+    int context_minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &context_major);
+    glGetIntegerv(GL_MINOR_VERSION, &context_minor);
+    return (context_major > major) || (context_major == major && context_minor >= minor);
+}
+
+// NOTE: needs a current context, call it after gladLoadGLLoader
+void load_extensions(void) {
+    // The indirect commands carry the draw index in baseInstance, which also needs ARB_base_instance
+    if (has_gl_version(4, 3) || (glfwExtensionSupported("GL_ARB_multi_draw_indirect") && glfwExtensionSupported("GL_ARB_base_instance"))) {
+        glad_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC) glfwGetProcAddress("glMultiDrawElementsIndirect");
+        GLAD_GL_ARB_multi_draw_indirect = (glad_glMultiDrawElementsIndirect != NULL);
+    }
+
+    // BC1 and BC3 are S3TC, BC5 is RGTC which is core since 3.0
+    GLAD_GL_EXT_texture_compression_s3tc = glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+
+    // Core since 4.1, some drivers expose the entry points but no binary format at all
+    if (has_gl_version(4, 1) || glfwExtensionSupported("GL_ARB_get_program_binary")) {
+        glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC) glfwGetProcAddress("glGetProgramBinary");
+        glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC) glfwGetProcAddress("glProgramBinary");
+        glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC) glfwGetProcAddress("glProgramParameteri");
+        int formats_count = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_count);
+        GLAD_GL_ARB_get_program_binary = glad_glGetProgramBinary != NULL && glad_glProgramBinary != NULL && glad_glProgramParameteri != NULL && formats_count > 0;
+    }
+
+    // The completion query is all the renderer needs, the thread count hint is optional
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile") || glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        GLAD_GL_KHR_parallel_shader_compile = 1;
+        glad_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (glad_glMaxShaderCompilerThreadsKHR == NULL) glad_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+        // 0xFFFFFFFF asks for as many threads as the implementation allows
+        if (glad_glMaxShaderCompilerThreadsKHR != NULL) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+
+    debug_info("multi draw indirect: %s\n", GLAD_GL_ARB_multi_draw_indirect ? "supported" : "not supported");
+    debug_info("s3tc texture compression: %s\n", GLAD_GL_EXT_texture_compression_s3tc ? "supported" : "not supported");
+    debug_info("program binaries: %s\n", GLAD_GL_ARB_get_program_binary ? "supported" : "not supported");
+    debug_info("parallel shader compile: %s\n", GLAD_GL_KHR_parallel_shader_compile ? "supported" : "not supported");
+
+    return;
+}
+
+#endif //_EXTENSIONS_H_
@@ -0,0 +1,81 @@
+#ifndef _HASH_MAP_H_
+#define _HASH_MAP_H_
+
+#include "./utils.h"
+
+// Minimum capacity of a map, it doubles whenever it is three quarters full
+#define HASH_MAP_SIZE 16
+
+// Open addressing map between 64 bit keys and values, the keys are expected to be hashes already.
+// NOTE: a zeroed map is a valid empty map
+typedef struct HashMap {
+    unsigned long long int* keys;
+    unsigned long long int* values;
+    bool* is_used;
+    unsigned int capacity;
+    unsigned int count;
+} HashMap;
+
+/* DECLARATIONS */
+
+bool hash_map_get(HashMap* map, unsigned long long int key, unsigned long long int* value);
+void hash_map_put(HashMap* map, unsigned long long int key, unsigned long long int value);
+void deallocate_hash_map(HashMap* map);
+
+/* ----------------------------------------------- */
+
+// Linear probing, the capacity is a power of two
+static unsigned int find_hash_map_slot(HashMap* map, unsigned long long int key) {
+    unsigned int slot = key & (map -> capacity - 1);
+    while (map -> is_used[slot] && map -> keys[slot] != key) slot = (slot + 1) & (map -> capacity - 1);
+    return slot;
+}
+
+static void grow_hash_map(HashMap* map) {
+    HashMap grown = { .capacity = map -> capacity ? map -> capacity * 2 : HASH_MAP_SIZE };
+    grown.keys = (unsigned long long int*) calloc(grown.capacity, sizeof(unsigned long long int));
+    grown.values = (unsigned long long int*) calloc(grown.capacity, sizeof(unsigned long long int));
+    grown.is_used = (bool*) calloc(grown.capacity, sizeof(bool));
+
+    for (unsigned int i = 0; i < map -> capacity; ++i) {
+        if (map -> is_used[i]) hash_map_put(&grown, map -> keys[i], map -> values[i]);
+    }
+
+    deallocate_hash_map(map);
+    *map = grown;
+
+    return;
+}
+
+bool hash_map_get(HashMap* map, unsigned long long int key, unsigned long long int* value) {
+    if (map -> count == 0) return FALSE;
+    unsigned int slot = find_hash_map_slot(map, key);
+    if (!(map -> is_used[slot])) return FALSE;
+    *value = map -> values[slot];
+    return TRUE;
+}
+
+// Replaces the value if the key is already present
+void hash_map_put(HashMap* map, unsigned long long int key, unsigned long long int value) {
+    if ((map -> count + 1) * 4 > map -> capacity * 3) grow_hash_map(map);
+
+    unsigned int slot = find_hash_map_slot(map, key);
+    if (!(map -> is_used[slot])) {
+        map -> is_used[slot] = TRUE;
+        map -> keys[slot] = key;
+        (map -> count)++;
+    }
+    map -> values[slot] = value;
+
+    return;
+}
+
+void deallocate_hash_map(HashMap* map) {
+    free(map -> keys);
+    free(map -> values);
+    free(map -> is_used);
+    *map = (HashMap) {0};
+    return;
+}
+
+#endif //_HASH_MAP_H_
@@ -7,6 +7,8 @@
 #include "./camera.h"
 #include "./GLFW/glfw3.h"
 #include "utils.h"
+#include "./shader.h"
+#include "./profiler.h"
 
 #define get_mouse_position() refresh_mouse_position(0.0f, 0.0f, TRUE)
 #define get_scroll_position() refresh_scroll_position(0.0f, TRUE)
@@ -16,38 +18,23 @@
 float* refresh_mouse_position(float x_offset, float y_offset, unsigned char ret);
 
 void processInput(GLFWwindow* window, Camera* camera) {
-    glPolygonMode(GL_FRONT_AND_BACK, GET_PRESSED_KEY(window, GLFW_KEY_L) ? GL_LINE : GL_FILL); // Set to wireframe mode
+    PROFILE_FUNCTION();
+    GL_CALL(glPolygonMode(GL_FRONT_AND_BACK, GET_PRESSED_KEY(window, GLFW_KEY_L) ? GL_LINE : GL_FILL)); // Set to wireframe mode
 
     if (GET_PRESSED_KEY(window, GLFW_KEY_W)) {
-        Vector temp = alloc_vector(0.0f, 1);
-        scalar_product_matrix(camera -> camera_front, camera -> camera_speed, &temp);
-        SUM_MATRICES(&(camera -> camera_pos), camera -> camera_pos, temp);
-        DEALLOCATE_MATRICES(temp);
+        camera -> camera_pos = vec3_sum(camera -> camera_pos, vec3_scalar_product(camera -> camera_front, camera -> camera_speed));
     } else if (GET_PRESSED_KEY(window, GLFW_KEY_S)) {
-        Vector temp = alloc_vector(0.0f, 1);
-        scalar_product_matrix(camera -> camera_front, -camera -> camera_speed, &temp);
-        SUM_MATRICES(&(camera -> camera_pos), camera -> camera_pos, temp);
-        DEALLOCATE_MATRICES(temp);
+        camera -> camera_pos = vec3_sum(camera -> camera_pos, vec3_scalar_product(camera -> camera_front, -camera -> camera_speed));
     } else if (GET_PRESSED_KEY(window, GLFW_KEY_A)) {
-        Vector temp = cross_product(camera -> camera_front, camera -> camera_up);
-        normalize_vector(temp, &temp);
-        scalar_product_matrix(temp, -camera -> camera_speed, &temp);
-        SUM_MATRICES(&(camera -> camera_pos), camera -> camera_pos, temp);
-        gc_dispose();
+        Vec3 temp = vec3_normalize(vec3_cross(camera -> camera_front, camera -> camera_up));
+        camera -> camera_pos = vec3_sum(camera -> camera_pos, vec3_scalar_product(temp, -camera -> camera_speed));
     } else if (GET_PRESSED_KEY(window, GLFW_KEY_D)) {
-        Vector temp = cross_product(camera -> camera_front, camera -> camera_up);
-        normalize_vector(temp, &temp);
-        scalar_product_matrix(temp, camera -> camera_speed, &temp);
-        SUM_MATRICES(&(camera -> camera_pos), camera -> camera_pos, temp);
-        gc_dispose();
+        Vec3 temp = vec3_normalize(vec3_cross(camera -> camera_front, camera -> camera_up));
+        camera -> camera_pos = vec3_sum(camera -> camera_pos, vec3_scalar_product(temp, camera -> camera_speed));
     } else if (GET_PRESSED_KEY(window, GLFW_KEY_UP) || GET_PRESSED_KEY(window, GLFW_KEY_SPACE)) {
-        Vector temp = VEC(0.0f, camera -> camera_speed, 0.0f);
-        SUM_MATRICES(&(camera -> camera_pos), camera -> camera_pos, temp);
-        DEALLOCATE_MATRICES(temp);
+        camera -> camera_pos = vec3_sum(camera -> camera_pos, vec3(0.0f, camera -> camera_speed, 0.0f));
     } else if (GET_PRESSED_KEY(window, GLFW_KEY_DOWN)) {
-        Vector temp = VEC(0.0f, -(camera -> camera_speed), 0.0f);
-        SUM_MATRICES(&(camera -> camera_pos), camera -> camera_pos, temp);
-        DEALLOCATE_MATRICES(temp);
+        camera -> camera_pos = vec3_sum(camera -> camera_pos, vec3(0.0f, -(camera -> camera_speed), 0.0f));
     } else if (GET_PRESSED_KEY(window, GLFW_KEY_ESCAPE)) {
         glfwSetWindowShouldClose(window, TRUE);
         printf("INPUT:KEY_PRESS_ESCAPE: closing the window...\n");
@@ -55,11 +42,7 @@ void processInput(GLFWwindow* window, Camera* camera) {
         // Reset the angles
         reset_angles(-90.0f, 0.0f);
         // Reset the camera
-        deallocate_camera(*camera);
-        Vector camera_pos = VEC(0.0f, 0.0f,  3.0f);
-        Vector camera_front = VEC(0.0f, 0.0f, -1.0f);
-        Vector camera_up = VEC(0.0f, 1.0f,  0.0f);
-        *camera = init_camera(camera_pos, camera_front, camera_up, 2.5f);
+        *camera = init_camera(vec3(0.0f, 0.0f,  3.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 1.0f,  0.0f), 2.5f);
         // Reset the camera speed
         update_camera_speed(camera, TRUE);
         printf("INPUT:RESET_KEY_PRESS: resetting the camera...\n");
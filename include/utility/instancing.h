@@ -0,0 +1,106 @@
+#ifndef _INSTANCING_H_
+#define _INSTANCING_H_
+
+#include "./model.h"
+
+// First of the four locations holding the rows of the per-instance transform
+#define INSTANCE_ATTRIBUTE 5
+
+// Copies of a loaded model, drawn with one instanced draw per mesh
+typedef struct ModelInstances {
+    Model* model;
+    unsigned int VAO;
+    unsigned int instances_buffer;
+    unsigned int capacity;
+    unsigned int count;
+} ModelInstances;
+
+/* DECLARATIONS */
+
+ModelInstances init_model_instances(Model* model, unsigned int capacity);
+void set_model_instances(ModelInstances* instances, const Mat4* transforms, unsigned int count);
+void draw_model_instances(ShaderVariants* shaders, ModelInstances* instances);
+void deallocate_model_instances(ModelInstances* instances);
+
+/* ----------------------------------------------- */
+
+// The VAO shares the vertex and index buffers of the model, only the instance buffer is owned
+ModelInstances init_model_instances(Model* model, unsigned int capacity) {
+    ModelInstances instances = { .model = model, .capacity = capacity, .count = 0 };
+
+    glGenVertexArrays(1, &(instances.VAO));
+    glGenBuffers(1, &(instances.instances_buffer));
+
+    glBindVertexArray(instances.VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, model -> VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model -> EBO);
+    setup_vertex_attributes();
+
+    // instance transforms, one row per location since a mat4 attribute spans four of them
+    glBindBuffer(GL_ARRAY_BUFFER, instances.instances_buffer);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Mat4), NULL, GL_STREAM_DRAW);
+    for (unsigned int i = 0; i < 4; ++i) {
+        glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+        glVertexAttribPointer(INSTANCE_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(Mat4), (void*) (i * sizeof(Vec4)));
+        glVertexAttribDivisor(INSTANCE_ATTRIBUTE + i, 1);
+    }
+
+    glBindVertexArray(0); // Unbind VAO
+    glBindBuffer(GL_ARRAY_BUFFER, 0); // Unbind VBO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // Unbind EBO
+
+    return instances;
+}
+
+// Upload the transforms of this frame, orphaning the previous storage so the driver does not wait on in-flight draws
+void set_model_instances(ModelInstances* instances, const Mat4* transforms, unsigned int count) {
+    if (count > instances -> capacity) instances -> capacity = count;
+    instances -> count = count;
+
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, instances -> instances_buffer));
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, (instances -> capacity) * sizeof(Mat4), NULL, GL_STREAM_DRAW));
+    GL_CALL(glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Mat4), transforms));
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    return;
+}
+
+// Drawn with the INSTANCED variants, switched as in draw_model
+void draw_model_instances(ShaderVariants* shaders, ModelInstances* instances) {
+    PROFILE_FUNCTION();
+    if (instances -> count == 0) return;
+
+    GL_CALL(glBindVertexArray(instances -> VAO));
+
+    Model* model = instances -> model;
+    ShaderProgram* shader = NULL;
+    unsigned int features = UINT32_MAX;
+    for (unsigned int i = 0; i < model -> meshes.count; ++i) {
+        ModelMesh* mesh = GET_ELEMENT(ModelMesh*, model -> meshes, i);
+        if (!(mesh -> is_resident)) continue;
+        if (mesh -> features != features) {
+            features = mesh -> features;
+            shader = use_shader_variant(shaders, FEATURE_INSTANCED | features);
+        }
+        if (shader == NULL) continue;
+        set_uniform_float(shader -> alpha_cutoff, mesh -> alpha_cutoff);
+        set_uniform_mat4(shader -> transform, mesh -> transformation_matrix.data);
+        bind_material(mesh -> bindings, mesh -> bindings_count);
+        GL_CALL(glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh -> indices_count, GL_UNSIGNED_INT, (void*) ((mesh -> first_index) * sizeof(unsigned int)), instances -> count, mesh -> base_vertex));
+    }
+
+    GL_CALL(glBindVertexArray(0)); // Unbind VAO
+
+    return;
+}
+
+void deallocate_model_instances(ModelInstances* instances) {
+    glDeleteVertexArrays(1, &(instances -> VAO));
+    glDeleteBuffers(1, &(instances -> instances_buffer));
+    instances -> count = 0;
+    instances -> capacity = 0;
+    return;
+}
+
+#endif //_INSTANCING_H_
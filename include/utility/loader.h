@@ -3,8 +3,27 @@
 
 #include "./parser.h"
 #include "./input.h"
+#include "./shader.h"
+#include "./extensions.h"
+#include "./program_cache.h"
+
+// Program being compiled and linked, the shaders are 0 when it was loaded from a binary
+typedef struct ShaderBuild {
+    unsigned int vertex_shader;
+    unsigned int fragment_shader;
+    unsigned int program;
+    unsigned long long int key;
+    bool is_binary;
+    double start_time;
+    double latency;
+} ShaderBuild;
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+unsigned int init_shaders_with_defines(const char* path_vertex_shader, const char* path_fragment_shader, const char* defines);
+bool start_shader_build(ShaderBuild* build, const char* path_vertex_shader, const char* path_fragment_shader, const char* defines);
+bool is_shader_build_done(ShaderBuild* build);
+unsigned int finish_shader_build(ShaderBuild* build);
+void cancel_shader_build(ShaderBuild* build);
 
 GLFWwindow* init_window(int width, int height, const char* title) {
     // Init GLFW
@@ -46,72 +65,168 @@ GLFWwindow* init_window(int width, int height, const char* title) {
         return NULL;
     }
 
+    // Load the entry points not covered by glad
+    load_extensions();
+
     // configure global opengl state
     glEnable(GL_DEPTH_TEST);
 
     return window;
 }
 
+// Each stage is passed to glShaderSource as the #version line, the defines, a #line directive and the rest of the file
+#define SHADER_SOURCE_PARTS 4
+
+// The defines must follow #version, "#line 2" keeps the line numbers of the compile errors those of the file
+static void split_shader_source(FileView file, const char* defines, const char** parts, int* lengths) {
+    const char* source = file.data != NULL ? (const char*) file.data : "";
+    int length = file.size;
+    int head_length = 0;
+    if (length >= 8 && !strncmp(source, "#version", 8)) {
+        while (head_length < length && source[head_length] != '\n') head_length++;
+        if (head_length < length) head_length++;
+    }
+
+    parts[0] = source;
+    parts[1] = defines;
+    parts[2] = head_length ? "#line 2\n" : "";
+    parts[3] = source + head_length;
+    lengths[0] = head_length;
+    lengths[1] = strlen(defines);
+    lengths[2] = strlen(parts[2]);
+    lengths[3] = length - head_length;
+
+    return;
+}
+
 unsigned int init_shaders(const char* path_vertex_shader, const char* path_fragment_shader) {
-    char infoLog[512];
-    const char* fragment_shader_data;
-    const char* vertex_shader_data;
-    int status;
+    return init_shaders_with_defines(path_vertex_shader, path_fragment_shader, "");
+}
 
-    // Load shaders
-    if ((vertex_shader_data = read_file(path_vertex_shader)) == NULL) {
-        return INT32_MAX;
-    }
+// Same as init_shaders, the defines ("#define NAME\n" lines) are inserted in both stages
+unsigned int init_shaders_with_defines(const char* path_vertex_shader, const char* path_fragment_shader, const char* defines) {
+    ShaderBuild build;
+    if (!start_shader_build(&build, path_vertex_shader, path_fragment_shader, defines)) return INT32_MAX;
+    unsigned int program = finish_shader_build(&build);
+    if (program != INT32_MAX) debug_info("program '%s' + '%s' %s in %.2f ms\n", path_vertex_shader, path_fragment_shader, build.is_binary ? "loaded from its binary" : "compiled from source", build.latency * 1000.0);
+    return program;
+}
 
-    if ((fragment_shader_data = read_file(path_fragment_shader)) == NULL) {
-        return INT32_MAX;
+// Issues both compiles and the link without checking any status, so the driver can overlap them with other builds.
+// A binary saved by a previous run skips both compiles and the link, the build is then done already
+bool start_shader_build(ShaderBuild* build, const char* path_vertex_shader, const char* path_fragment_shader, const char* defines) {
+    FileView vertex_shader_file;
+    FileView fragment_shader_file;
+    *build = (ShaderBuild) { .start_time = glfwGetTime() };
+
+    // Map the shaders, the sources are passed with their length since the views are not NUL terminated
+    if (!map_file(path_vertex_shader, FILE_ACCESS_PREFETCH, &vertex_shader_file)) {
+        error_info("failed to open the shader '%s'\n", path_vertex_shader);
+        return FALSE;
     }
 
-    // Retrieve the vertex shaders
-    unsigned int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_data, NULL);
-    glCompileShader(vertex_shader);
+    if (!map_file(path_fragment_shader, FILE_ACCESS_PREFETCH, &fragment_shader_file)) {
+        error_info("failed to open the shader '%s'\n", path_fragment_shader);
+        unmap_file(&vertex_shader_file);
+        return FALSE;
+    }
 
-    // Check for shader compile errors
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(vertex_shader, 512, NULL, infoLog);
-        printf("ERROR::SHADER::VERTEX::COMPILATION_FAILED: %s\n", infoLog);
-        return INT32_MAX;
+    // The vertex parts come first, then the fragment ones
+    const char* sources[2 * SHADER_SOURCE_PARTS];
+    int lengths[2 * SHADER_SOURCE_PARTS];
+    split_shader_source(vertex_shader_file, defines, sources, lengths);
+    split_shader_source(fragment_shader_file, defines, sources + SHADER_SOURCE_PARTS, lengths + SHADER_SOURCE_PARTS);
+
+    build -> key = get_program_key(sources, lengths, 2 * SHADER_SOURCE_PARTS);
+    build -> program = load_program_binary(build -> key);
+    if (build -> program) {
+        build -> is_binary = TRUE;
+        unmap_file(&vertex_shader_file);
+        unmap_file(&fragment_shader_file);
+        return TRUE;
     }
 
-    // Retrieve the fragment shader
-    unsigned int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_data, NULL);
-    glCompileShader(fragment_shader);
+    build -> vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(build -> vertex_shader, SHADER_SOURCE_PARTS, sources, lengths);
+    glCompileShader(build -> vertex_shader);
 
-    // Check for shader compile errors
-    glGetProgramiv(fragment_shader, GL_LINK_STATUS, &status);
-    if (!status) {
-        glGetShaderInfoLog(fragment_shader, 512, NULL, infoLog);
-        printf("ERROR::SHADER::FRAGMENT::COMPILATION_FAILED: %s\n", infoLog);
-        return INT32_MAX;
-    }
+    build -> fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(build -> fragment_shader, SHADER_SOURCE_PARTS, sources + SHADER_SOURCE_PARTS, lengths + SHADER_SOURCE_PARTS);
+    glCompileShader(build -> fragment_shader);
+
+    // The sources are copied by glShaderSource
+    unmap_file(&vertex_shader_file);
+    unmap_file(&fragment_shader_file);
 
-    // Link shaders
-    unsigned int vertex_shader_program = glCreateProgram();
-    glAttachShader(vertex_shader_program, vertex_shader);
-    glAttachShader(vertex_shader_program, fragment_shader);
-    glLinkProgram(vertex_shader_program);
+    // The link waits for the compiles inside the driver, a failed compile shows up as a failed link
+    build -> program = glCreateProgram();
+    glAttachShader(build -> program, build -> vertex_shader);
+    glAttachShader(build -> program, build -> fragment_shader);
+    mark_program_retrievable(build -> program);
+    glLinkProgram(build -> program);
 
-    // Check for linking errors
-    glGetProgramiv(vertex_shader_program, GL_LINK_STATUS, &status);
+    return TRUE;
+}
+
+// Never blocks with KHR_parallel_shader_compile, without it the build is reported done and finish_shader_build waits for it
+bool is_shader_build_done(ShaderBuild* build) {
+    if (build -> is_binary || !GLAD_GL_KHR_parallel_shader_compile) return TRUE;
+    int is_completed = GL_FALSE;
+    glGetProgramiv(build -> program, GL_COMPLETION_STATUS_KHR, &is_completed);
+    return is_completed;
+}
+
+static void print_shader_compile_error(unsigned int shader, const char* stage) {
+    char infoLog[512];
+    int status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
     if (!status) {
-        glGetProgramInfoLog(vertex_shader_program, 512, NULL, infoLog);
-        printf("ERROR::SHADER::PROGRAM::LINKING_FAILED: %s\n", infoLog);
-        return INT32_MAX;
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        printf("ERROR::SHADER::%s::COMPILATION_FAILED: %s\n", stage, infoLog);
     }
+    return;
+}
 
-    // Deallocate the shaders
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+// Checks the link, saves the binary for the next run and caches the uniform locations, returns INT32_MAX on failure
+unsigned int finish_shader_build(ShaderBuild* build) {
+    char infoLog[512];
+    int status;
+    unsigned int program = build -> program;
+
+    if (!(build -> is_binary)) {
+        // Check for linking errors, then for the compile errors that caused them
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (!status) {
+            print_shader_compile_error(build -> vertex_shader, "VERTEX");
+            print_shader_compile_error(build -> fragment_shader, "FRAGMENT");
+            glGetProgramInfoLog(program, 512, NULL, infoLog);
+            printf("ERROR::SHADER::PROGRAM::LINKING_FAILED: %s\n", infoLog);
+            glDeleteProgram(program);
+            program = INT32_MAX;
+        } else save_program_binary(program, build -> key);
+
+        // Deallocate the shaders
+        glDeleteShader(build -> vertex_shader);
+        glDeleteShader(build -> fragment_shader);
+    }
+
+    build -> latency = glfwGetTime() - build -> start_time;
+    if (program == INT32_MAX) return INT32_MAX;
+
+    // Cache the uniform locations of the program
+    build_uniform_table(program);
 
-    return vertex_shader_program;
+    return program;
+}
+
+// Drops a build that is no longer wanted, nothing is queried so it does not wait for the driver
+void cancel_shader_build(ShaderBuild* build) {
+    if (!(build -> is_binary)) {
+        glDeleteShader(build -> vertex_shader);
+        glDeleteShader(build -> fragment_shader);
+    }
+    glDeleteProgram(build -> program);
+    return;
 }
 
 // Whenever the window size changed (by OS or user resize) this callback function executes
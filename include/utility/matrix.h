@@ -5,7 +5,10 @@
 #include <math.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <string.h>
 #include "./types.h"
+#include "./simd.h"
+#include "./arena.h"
 
 #define TRUE 1
 #define FALSE 0
@@ -25,13 +28,14 @@
 #define SUM_MATRICES(...) sum_matrices(sizeof((Matrix[]) {*__VA_ARGS__}) / sizeof(Matrix) - 1, __VA_ARGS__)
 #define DOT_PRODUCT_MATRIX(...) dot_product_matrix(sizeof((Matrix[]) {*__VA_ARGS__}) / sizeof(Matrix) - 1, __VA_ARGS__)
 #define PRINT_MAT(mat) print_matrix(mat, #mat)
+#define MAT4_INDEX(mat, row, col) (((mat).data)[(4 * (row)) + (col)])
+#define PRINT_MAT4(mat) print_mat4(mat, #mat)
 
 /* DECLARATIONS */
 
 void print_matrix(Matrix mat, const char* mat_name);
 void reshape_matrix(unsigned int rows, unsigned int cols, Matrix* mat);
 Matrix alloc_matrix(float init_val, unsigned int rows, unsigned int cols);
-void gc_dispose(void);
 Matrix alloc_temp_matrix(float init_val, unsigned int rows, unsigned int cols);
 void deallocate_matrices(int len, ...);
 Matrix create_identity_matrix(unsigned int size);
@@ -51,6 +55,43 @@ void transpose_matrix(Matrix src, Matrix* dest);
 Matrix cast_mat(float* mat_data, unsigned int rows, unsigned int cols, bool is_row_major);
 Matrix quat_to_mat4(Quaternion quat);
 
+Vec3 vec3(float x, float y, float z);
+Vec4 vec4(float x, float y, float z, float w);
+float vec3_length(Vec3 vec);
+float vec4_length(Vec4 vec);
+float vec3_dot(Vec3 a, Vec3 b);
+float vec4_dot(Vec4 a, Vec4 b);
+Vec3 vec3_normalize(Vec3 vec);
+Vec4 vec4_normalize(Vec4 vec);
+Vec3 vec3_cross(Vec3 a, Vec3 b);
+Vec3 vec3_sum(Vec3 a, Vec3 b);
+Vec4 vec4_sum(Vec4 a, Vec4 b);
+Vec3 vec3_scalar_sum(Vec3 vec, float scalar);
+Vec4 vec4_scalar_sum(Vec4 vec, float scalar);
+Vec3 vec3_scalar_product(Vec3 vec, float scalar);
+Vec4 vec4_scalar_product(Vec4 vec, float scalar);
+Vec3 vec3_negate(Vec3 vec);
+Vec4 vec4_negate(Vec4 vec);
+void print_mat4(Mat4 mat, const char* mat_name);
+Mat4 mat4_identity(void);
+Mat4 mat4_from_array(const float* mat_data, bool is_row_major);
+Vec4 mat4_get_col(Mat4 mat, unsigned int col);
+Mat4 mat4_set_col(Mat4 mat, Vec4 vec, unsigned int col);
+Mat4 mat4_sum(Mat4 a, Mat4 b);
+Mat4 mat4_scalar_sum(Mat4 mat, float scalar);
+Mat4 mat4_scalar_product(Mat4 mat, float scalar);
+Mat4 mat4_negate(Mat4 mat);
+Mat4 mat4_mul(Mat4 a, Mat4 b);
+Vec4 mat4_mul_vec4(Mat4 mat, Vec4 vec);
+void mat4_mul_batch(Mat4 a, const Mat4* src, Mat4* dest, unsigned int count);
+Mat4 mat4_transpose(Mat4 mat);
+Mat4 mat4_from_quat(Quat quat);
+Mat4 mat4_from_matrix(Matrix mat);
+Vec3 vec3_from_vector(Vector vec);
+Vec4 vec4_from_vector(Vector vec);
+void mat4_to_matrix(Mat4 src, unsigned int size, Matrix* dest);
+Matrix matrix_from_mat4(Mat4 src);
+
 /* ----------------------------------------------- */
 
 // NOTE: The matrices are row-major order, while the vectors are column-major order
@@ -72,8 +113,23 @@ void print_matrix(Matrix mat, const char* mat_name) {
 }
 
 void reshape_matrix(unsigned int rows, unsigned int cols, Matrix* mat) {
+    unsigned int old_size = (mat -> rows) * (mat -> cols);
     mat -> rows = rows;
     mat -> cols = cols;
+
+    // Keep the same buffer when the number of elements does not change
+    if (rows * cols == old_size && mat -> data != NULL) return;
+
+    // Temporary matrices can only grow inside the frame arena
+    if (frame_arena_owns(mat -> data)) {
+        if (rows * cols > old_size) {
+            float* data = (float*) frame_arena_alloc(rows * cols * sizeof(float));
+            memcpy(data, mat -> data, old_size * sizeof(float));
+            mat -> data = data;
+        }
+        return;
+    }
+
     mat -> data = (float*) realloc(mat -> data, cols * rows * sizeof(float));
     if (mat -> data == NULL) {
         printf("MATRIX::RESHAPE_MATRIX: Failed to reallocate the matrix data!\n");
@@ -102,34 +158,20 @@ Matrix alloc_matrix(float init_val, unsigned int rows, unsigned int cols) {
     return mat;
 }
 
-void gc_dispose(void) {
-    Matrix mat = alloc_temp_matrix(0.0f, 0, 0);
-    (void) mat;
-    return;
-}
-
+// Temporary matrices live in the frame arena, they are released by frame_arena_reset and must not be deallocated
 Matrix alloc_temp_matrix(float init_val, unsigned int rows, unsigned int cols) {
-    static float** gc_pointer;
-    static unsigned int count = 0;
+    // Check if the given size is valid
+    assert(rows >= 1 && cols >= 1);
 
-    if (rows == 0 && cols == 0) {
-        free(gc_pointer);
-        count = 0;
-        return (Matrix) {0};
-    }
+    Matrix mat = {0};
+    mat.rows = rows;
+    mat.cols = cols;
+    mat.data = (float*) frame_arena_alloc(rows * cols * sizeof(float));
 
-    if (count == 0) {
-        gc_pointer = (float**) calloc(1, sizeof(float*));
-        Matrix mat = alloc_matrix(init_val, rows, cols);
-        gc_pointer[count] = mat.data;
-        count++;
-        return mat;
+    for (unsigned int i = 0; i < rows * cols; ++i) {
+        mat.data[i] = init_val;
     }
 
-    gc_pointer = (float**) realloc(gc_pointer, (count + 1) * sizeof(float*));
-    Matrix mat = alloc_matrix(init_val, rows, cols);
-    gc_pointer[count] = mat.data;
-    count++;
     return mat;
 }
 
@@ -139,7 +181,7 @@ void deallocate_matrices(int len, ...) {
 
     for (int i = 0; i < len; ++i) {
         Matrix mat = va_arg(args, Matrix);
-        free(mat.data);
+        if (!frame_arena_owns(mat.data)) free(mat.data);
     }
 
     va_end(args);
@@ -215,7 +257,7 @@ void normalize_vector(Vector vec, Vector* normalized_vec) {
     assert(IS_VEC(vec));
 
     unsigned int vec_size = VEC_SIZE(vec);
-    Vector temp = alloc_vector(0.0f, vec_size);
+    Vector temp = alloc_temp_vector(0.0f, vec_size);
 
     float len = get_vector_length(vec);
 
@@ -226,9 +268,6 @@ void normalize_vector(Vector vec, Vector* normalized_vec) {
     // Copy the temp vector back to the normalized one
     copy_matrix(temp, normalized_vec);
 
-    // Deallocate unused vector
-    DEALLOCATE_MATRICES(temp);
-
     return;
 }
 
@@ -236,11 +275,12 @@ Vector cross_product(Vector a, Vector b) {
     // Check if the given vectors have more than one component
     assert(IS_VEC(a) && IS_VEC(b) && (a.rows == b.rows) && (a.rows == 3));
 
+    Vec3 cross = vec3_cross(vec3_from_vector(a), vec3_from_vector(b));
     Matrix result = alloc_temp_vector(0.0f, a.rows);
 
-    VEC_INDEX(result, 0) = VEC_INDEX(a, 1) * VEC_INDEX(b, 2) - VEC_INDEX(a, 2) * VEC_INDEX(b, 1);
-    VEC_INDEX(result, 1) = VEC_INDEX(a, 2) * VEC_INDEX(b, 0) - VEC_INDEX(a, 0) * VEC_INDEX(b, 2);
-    VEC_INDEX(result, 2) = VEC_INDEX(a, 0) * VEC_INDEX(b, 1) - VEC_INDEX(a, 1) * VEC_INDEX(b, 0);
+    for (unsigned int i = 0; i < 3; ++i) {
+        VEC_INDEX(result, i) = VEC_INDEX(cross, i);
+    }
 
     return result;
 }
@@ -264,7 +304,7 @@ Vector vec(int len, ...) {
 }
 
 void scalar_sum_matrix(Matrix src, float scalar, Matrix* dest) {
-    Matrix temp = alloc_matrix(0.0f, 1, 1);
+    Matrix temp = alloc_temp_matrix(0.0f, src.rows, src.cols);
     copy_matrix(src, &temp);
 
     // Sum each element with the scalar
@@ -275,13 +315,12 @@ void scalar_sum_matrix(Matrix src, float scalar, Matrix* dest) {
     }
 
     copy_matrix(temp, dest);
-    DEALLOCATE_MATRICES(temp);
 
     return;
 }
 
 void scalar_product_matrix(Matrix src, float scalar, Matrix* dest) {
-    Matrix temp = alloc_matrix(0.0f, 1, 1);
+    Matrix temp = alloc_temp_matrix(0.0f, src.rows, src.cols);
     copy_matrix(src, &temp);
 
     // Multiply each element with the scalar
@@ -292,7 +331,6 @@ void scalar_product_matrix(Matrix src, float scalar, Matrix* dest) {
     }
 
     copy_matrix(temp, dest);
-    DEALLOCATE_MATRICES(temp);
 
     return;
 }
@@ -312,7 +350,7 @@ void sum_matrices(int len, ...) {
     Matrix* dest = va_arg(args, Matrix*);
     Matrix a = va_arg(args, Matrix);
 
-    Matrix temp = alloc_matrix(0.0f, a.rows, a.cols);
+    Matrix temp = alloc_temp_matrix(0.0f, a.rows, a.cols);
 
     // Sum each matrix and store the result inside the destination matrix
     for (int i = 0; i < len; ++i) {
@@ -334,9 +372,6 @@ void sum_matrices(int len, ...) {
     // Copy the temp matrix back to the destination matrix
     copy_matrix(temp, dest);
 
-    // Deallocate the temp matrix
-    DEALLOCATE_MATRICES(temp);
-
     return;
 }
 
@@ -349,18 +384,11 @@ void dot_product_matrix(int len, ...) {
     Matrix* dest = va_arg(args, Matrix*);
     Matrix a = va_arg(args, Matrix);
 
-    // Create the temp matrix that will hold the result
-    float** temp = (float**) calloc(a.rows, sizeof(float*));
+    // Create the temp matrix that will hold the result and copy the value of a into it
     unsigned int temp_rows = a.rows;
     unsigned int temp_cols = a.cols;
-
-    // Copy the value of a into temp
-    for (unsigned int row = 0; row < temp_rows; ++row) {
-        temp[row] = (float*) calloc(temp_cols, sizeof(float));
-        for (unsigned int col = 0; col < temp_cols; ++col) {
-            temp[row][col] = MAT_INDEX(a, row, col);
-        }
-    }
+    float* temp = (float*) frame_arena_alloc(temp_rows * temp_cols * sizeof(float));
+    memcpy(temp, a.data, temp_rows * temp_cols * sizeof(float));
 
     // Multiply each matrix and store the result inside the destination matrix
     for (int i = 0; i < len - 1; ++i) {
@@ -369,23 +397,26 @@ void dot_product_matrix(int len, ...) {
         // Assert that the matrices can be multiplied (temp x b)
         assert(temp_cols == b.rows);
 
-        // Multiply the two matrices and store the result inside the result matrix
-        for (unsigned int row = 0; row < temp_rows; ++row) {
-            // Init the row array that will hold the resulting row for each multiplication
-            float* new_row = (float*) calloc(b.cols, sizeof(float));
+        // Use the vectorized kernel for the common 4x4 case
+        if (temp_rows == 4 && temp_cols == 4 && b.cols == 4) {
+            Mat4 product = mat4_mul(mat4_from_array(temp, TRUE), mat4_from_matrix(b));
+            memcpy(temp, product.data, sizeof(product.data));
+            continue;
+        }
 
+        // Multiply the two matrices and store the result inside the product matrix
+        float* product = (float*) frame_arena_alloc(temp_rows * b.cols * sizeof(float));
+        memset(product, 0, temp_rows * b.cols * sizeof(float));
+        for (unsigned int row = 0; row < temp_rows; ++row) {
             for (unsigned int col = 0; col < b.cols; ++col) {
-
                 for (unsigned int i = 0; i < temp_cols; ++i) {
-                    new_row[col] += temp[row][i] * MAT_INDEX(b, i, col);
+                    product[row * b.cols + col] += temp[row * temp_cols + i] * MAT_INDEX(b, i, col);
                 }
             }
-
-            // Copy the new row into the old one
-            temp[row] = new_row;
         }
 
-        // Set the new number of temp cols
+        // Replace the old temp matrix with the product
+        temp = product;
         temp_cols = b.cols;
     }
 
@@ -393,15 +424,7 @@ void dot_product_matrix(int len, ...) {
 
     // Copy the temp matrix into the destination matrix
     reshape_matrix(temp_rows, temp_cols, dest);
-    for (unsigned int row = 0; row < temp_rows; ++row) {
-        for (unsigned int col = 0; col < temp_cols; ++col) {
-            MAT_INDEX(*dest, row, col) = temp[row][col];
-        }
-        // Deallocate copied row
-        free(temp[row]);
-    }
-
-    free(temp);
+    memcpy(dest -> data, temp, temp_rows * temp_cols * sizeof(float));
 
     return;
 }
@@ -430,23 +453,260 @@ Matrix cast_mat(float* mat_data, unsigned int rows, unsigned int cols, bool is_r
 }
 
 Matrix quat_to_mat4(Quaternion quat) {
-    Matrix mat = create_identity_matrix(4);
+    return matrix_from_mat4(mat4_from_quat(vec4_from_vector(quat)));
+}
+
+/* FIXED-SIZE TYPES */
+
+Vec3 vec3(float x, float y, float z) {
+    return (Vec3) {{x, y, z}};
+}
+
+Vec4 vec4(float x, float y, float z, float w) {
+    return (Vec4) {{x, y, z, w}};
+}
+
+float vec3_length(Vec3 vec) {
+    return sqrtf(vec3_dot(vec, vec));
+}
+
+float vec4_length(Vec4 vec) {
+    return sqrtf(vec4_dot(vec, vec));
+}
+
+float vec3_dot(Vec3 a, Vec3 b) {
+    return VEC_INDEX(a, 0) * VEC_INDEX(b, 0) + VEC_INDEX(a, 1) * VEC_INDEX(b, 1) + VEC_INDEX(a, 2) * VEC_INDEX(b, 2);
+}
+
+float vec4_dot(Vec4 a, Vec4 b) {
+    return VEC_INDEX(a, 0) * VEC_INDEX(b, 0) + VEC_INDEX(a, 1) * VEC_INDEX(b, 1) + VEC_INDEX(a, 2) * VEC_INDEX(b, 2) + VEC_INDEX(a, 3) * VEC_INDEX(b, 3);
+}
+
+Vec3 vec3_normalize(Vec3 vec) {
+    return vec3_scalar_product(vec, 1.0f / vec3_length(vec));
+}
+
+Vec4 vec4_normalize(Vec4 vec) {
+    return vec4_scalar_product(vec, 1.0f / vec4_length(vec));
+}
+
+Vec3 vec3_cross(Vec3 a, Vec3 b) {
+    Vec3 result;
+    VEC_INDEX(result, 0) = VEC_INDEX(a, 1) * VEC_INDEX(b, 2) - VEC_INDEX(a, 2) * VEC_INDEX(b, 1);
+    VEC_INDEX(result, 1) = VEC_INDEX(a, 2) * VEC_INDEX(b, 0) - VEC_INDEX(a, 0) * VEC_INDEX(b, 2);
+    VEC_INDEX(result, 2) = VEC_INDEX(a, 0) * VEC_INDEX(b, 1) - VEC_INDEX(a, 1) * VEC_INDEX(b, 0);
+    return result;
+}
+
+Vec3 vec3_sum(Vec3 a, Vec3 b) {
+    for (unsigned int i = 0; i < 3; ++i) {
+        VEC_INDEX(a, i) += VEC_INDEX(b, i);
+    }
+    return a;
+}
+
+Vec4 vec4_sum(Vec4 a, Vec4 b) {
+    for (unsigned int i = 0; i < 4; ++i) {
+        VEC_INDEX(a, i) += VEC_INDEX(b, i);
+    }
+    return a;
+}
+
+Vec3 vec3_scalar_sum(Vec3 vec, float scalar) {
+    for (unsigned int i = 0; i < 3; ++i) {
+        VEC_INDEX(vec, i) += scalar;
+    }
+    return vec;
+}
+
+Vec4 vec4_scalar_sum(Vec4 vec, float scalar) {
+    for (unsigned int i = 0; i < 4; ++i) {
+        VEC_INDEX(vec, i) += scalar;
+    }
+    return vec;
+}
+
+Vec3 vec3_scalar_product(Vec3 vec, float scalar) {
+    for (unsigned int i = 0; i < 3; ++i) {
+        VEC_INDEX(vec, i) *= scalar;
+    }
+    return vec;
+}
+
+Vec4 vec4_scalar_product(Vec4 vec, float scalar) {
+    for (unsigned int i = 0; i < 4; ++i) {
+        VEC_INDEX(vec, i) *= scalar;
+    }
+    return vec;
+}
+
+Vec3 vec3_negate(Vec3 vec) {
+    return vec3_scalar_product(vec, -1.0f);
+}
+
+Vec4 vec4_negate(Vec4 vec) {
+    return vec4_scalar_product(vec, -1.0f);
+}
+
+void print_mat4(Mat4 mat, const char* mat_name) {
+    printf("-------------------------------------\n");
+    printf("Mat4 '%s': \n", mat_name);
+
+    for (unsigned int row = 0; row < 4; ++row) {
+        for (unsigned int col = 0; col < 4; ++col) {
+            printf(" %e ", MAT4_INDEX(mat, row, col));
+        }
+        printf("\n");
+    }
+
+    printf("-------------------------------------\n");
+
+    return;
+}
+
+Mat4 mat4_identity(void) {
+    Mat4 mat = {0};
+
+    for (unsigned int i = 0; i < 4; ++i) {
+        MAT4_INDEX(mat, i, i) = 1.0f;
+    }
+
+    return mat;
+}
+
+Mat4 mat4_from_array(const float* mat_data, bool is_row_major) {
+    Mat4 mat;
+
+    for (unsigned int r = 0; r < 4; ++r) {
+        for (unsigned int c = 0; c < 4; ++c) {
+            MAT4_INDEX(mat, r, c) = is_row_major ? mat_data[r * 4 + c] : mat_data[c * 4 + r];
+        }
+    }
+
+    return mat;
+}
+
+Vec4 mat4_get_col(Mat4 mat, unsigned int col) {
+    assert(col < 4);
+    return (Vec4) {{MAT4_INDEX(mat, 0, col), MAT4_INDEX(mat, 1, col), MAT4_INDEX(mat, 2, col), MAT4_INDEX(mat, 3, col)}};
+}
+
+Mat4 mat4_set_col(Mat4 mat, Vec4 vec, unsigned int col) {
+    assert(col < 4);
+
+    for (unsigned int row = 0; row < 4; ++row) {
+        MAT4_INDEX(mat, row, col) = VEC_INDEX(vec, row);
+    }
+
+    return mat;
+}
+
+Mat4 mat4_sum(Mat4 a, Mat4 b) {
+    for (unsigned int i = 0; i < 16; ++i) {
+        a.data[i] += b.data[i];
+    }
+    return a;
+}
+
+Mat4 mat4_scalar_sum(Mat4 mat, float scalar) {
+    for (unsigned int i = 0; i < 16; ++i) {
+        mat.data[i] += scalar;
+    }
+    return mat;
+}
+
+Mat4 mat4_scalar_product(Mat4 mat, float scalar) {
+    for (unsigned int i = 0; i < 16; ++i) {
+        mat.data[i] *= scalar;
+    }
+    return mat;
+}
+
+Mat4 mat4_negate(Mat4 mat) {
+    return mat4_scalar_product(mat, -1.0f);
+}
+
+Mat4 mat4_mul(Mat4 a, Mat4 b) {
+    return __atomic_load_n(&mat4_mul_kernel, __ATOMIC_RELAXED)(a, b);
+}
+
+Vec4 mat4_mul_vec4(Mat4 mat, Vec4 vec) {
+    return __atomic_load_n(&mat4_mul_vec4_kernel, __ATOMIC_RELAXED)(mat, vec);
+}
+
+// dest[i] = a * src[i], dest may alias src
+void mat4_mul_batch(Mat4 a, const Mat4* src, Mat4* dest, unsigned int count) {
+    __atomic_load_n(&mat4_mul_batch_kernel, __ATOMIC_RELAXED)(a, src, dest, count);
+    return;
+}
+
+Mat4 mat4_transpose(Mat4 mat) {
+    Mat4 result;
+
+    for (unsigned int row = 0; row < 4; ++row) {
+        for (unsigned int col = 0; col < 4; ++col) {
+            MAT4_INDEX(result, row, col) = MAT4_INDEX(mat, col, row);
+        }
+    }
+
+    return result;
+}
+
+Mat4 mat4_from_quat(Quat quat) {
+    Mat4 mat = mat4_identity();
 
     // First row
-    MAT_INDEX(mat, 0, 0) = 2 * (powf(QUAT_INDEX(quat, 0), 2.0f) + powf(QUAT_INDEX(quat, 1), 2.0f)) - 1.0f;
-    MAT_INDEX(mat, 0, 1) = 2 * (QUAT_INDEX(quat, 1) * QUAT_INDEX(quat, 2) - QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 3));
-    MAT_INDEX(mat, 0, 2) = 2 * (QUAT_INDEX(quat, 1) * QUAT_INDEX(quat, 3) + QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 2));
+    MAT4_INDEX(mat, 0, 0) = 2 * (powf(QUAT_INDEX(quat, 0), 2.0f) + powf(QUAT_INDEX(quat, 1), 2.0f)) - 1.0f;
+    MAT4_INDEX(mat, 0, 1) = 2 * (QUAT_INDEX(quat, 1) * QUAT_INDEX(quat, 2) - QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 3));
+    MAT4_INDEX(mat, 0, 2) = 2 * (QUAT_INDEX(quat, 1) * QUAT_INDEX(quat, 3) + QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 2));
 
     // Second row
-    MAT_INDEX(mat, 1, 0) = 2 * (QUAT_INDEX(quat, 1) * QUAT_INDEX(quat, 2) + QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 3));
-    MAT_INDEX(mat, 1, 1) = 2 * (powf(QUAT_INDEX(quat, 0), 2.0f) + powf(QUAT_INDEX(quat, 2), 2.0f)) - 1.0f;
-    MAT_INDEX(mat, 1, 2) = 2 * (QUAT_INDEX(quat, 2) * QUAT_INDEX(quat, 3) - QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 1));
+    MAT4_INDEX(mat, 1, 0) = 2 * (QUAT_INDEX(quat, 1) * QUAT_INDEX(quat, 2) + QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 3));
+    MAT4_INDEX(mat, 1, 1) = 2 * (powf(QUAT_INDEX(quat, 0), 2.0f) + powf(QUAT_INDEX(quat, 2), 2.0f)) - 1.0f;
+    MAT4_INDEX(mat, 1, 2) = 2 * (QUAT_INDEX(quat, 2) * QUAT_INDEX(quat, 3) - QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 1));
 
     // Third row
-    MAT_INDEX(mat, 2, 0) = 2 * (QUAT_INDEX(quat, 1) * QUAT_INDEX(quat, 3) - QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 2));
-    MAT_INDEX(mat, 2, 1) = 2 * (QUAT_INDEX(quat, 2) * QUAT_INDEX(quat, 3) + QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 1));
-    MAT_INDEX(mat, 2, 2) = 2 * (powf(QUAT_INDEX(quat, 0), 2.0f) + powf(QUAT_INDEX(quat, 3), 2.0f)) - 1.0f;
+    MAT4_INDEX(mat, 2, 0) = 2 * (QUAT_INDEX(quat, 1) * QUAT_INDEX(quat, 3) - QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 2));
+    MAT4_INDEX(mat, 2, 1) = 2 * (QUAT_INDEX(quat, 2) * QUAT_INDEX(quat, 3) + QUAT_INDEX(quat, 0) * QUAT_INDEX(quat, 1));
+    MAT4_INDEX(mat, 2, 2) = 2 * (powf(QUAT_INDEX(quat, 0), 2.0f) + powf(QUAT_INDEX(quat, 3), 2.0f)) - 1.0f;
+
+    return mat;
+}
+
+/* MATRIX COMPATIBILITY */
+
+Mat4 mat4_from_matrix(Matrix mat) {
+    assert(mat.rows == 4 && mat.cols == 4);
+    return mat4_from_array(mat.data, TRUE);
+}
+
+Vec3 vec3_from_vector(Vector vec) {
+    assert(IS_VEC(vec) && VEC_SIZE(vec) >= 3);
+    return vec3(VEC_INDEX(vec, 0), VEC_INDEX(vec, 1), VEC_INDEX(vec, 2));
+}
+
+Vec4 vec4_from_vector(Vector vec) {
+    assert(IS_VEC(vec) && VEC_SIZE(vec) >= 4);
+    return vec4(VEC_INDEX(vec, 0), VEC_INDEX(vec, 1), VEC_INDEX(vec, 2), VEC_INDEX(vec, 3));
+}
+
+// Copy the upper-left size x size block of src into dest, padding with the identity when size > 4
+void mat4_to_matrix(Mat4 src, unsigned int size, Matrix* dest) {
+    reshape_matrix(size, size, dest);
+
+    for (unsigned int row = 0; row < size; ++row) {
+        for (unsigned int col = 0; col < size; ++col) {
+            if (row < 4 && col < 4) MAT_INDEX(*dest, row, col) = MAT4_INDEX(src, row, col);
+            else MAT_INDEX(*dest, row, col) = (row == col) ? 1.0f : 0.0f;
+        }
+    }
+
+    return;
+}
 
+Matrix matrix_from_mat4(Mat4 src) {
+    Matrix mat = alloc_matrix(0.0f, 4, 4);
+    mat4_to_matrix(src, 4, &mat);
     return mat;
 }
 
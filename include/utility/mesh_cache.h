@@ -0,0 +1,283 @@
+#ifndef _MESH_CACHE_H_
+#define _MESH_CACHE_H_
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include "./utils.h"
+#include "./parser.h"
+#include "./texture_cache.h"
+
+// Preprocessed models: the packed vertex and index buffers followed by the node meshes and the textures they bind.
+// Every section starts at MESH_CACHE_ALIGNMENT, so a mapped cache file can be handed straight to glBufferData.
+#define MESH_CACHE_DIRECTORY "./cache/"
+#define MESH_CACHE_MAGIC 0x4853454D // "MESH"
+#define MESH_CACHE_VERSION 3
+#define MESH_CACHE_ALIGNMENT 64
+#define MESH_CACHE_SCAN_DEPTH 3
+#define ALIGN_CACHE_OFFSET(offset) (((offset) + MESH_CACHE_ALIGNMENT - 1) & ~((unsigned long long int) MESH_CACHE_ALIGNMENT - 1))
+
+typedef struct MeshCacheHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long int source_hash;
+    unsigned long long int source_mtime;
+    unsigned int vertex_size;
+    unsigned int vertices_count;
+    unsigned int indices_count;
+    unsigned int meshes_count;
+    unsigned int textures_count;
+    unsigned int strings_size;
+    unsigned long long int vertices_offset;
+    unsigned long long int indices_offset;
+    unsigned long long int meshes_offset;
+    unsigned long long int textures_offset;
+    unsigned long long int strings_offset;
+    unsigned long long int file_size;
+} MeshCacheHeader;
+
+// Bindings reference the textures section, since the GL names differ at every run
+typedef struct CachedBinding {
+    unsigned int unit;
+    unsigned int texture_index;
+} CachedBinding;
+
+typedef struct CachedMesh {
+    Mat4 transformation_matrix;
+    int base_vertex;
+    unsigned int first_index;
+    unsigned int vertices_count;
+    unsigned int indices_count;
+    unsigned int mesh_index;
+    unsigned int features;
+    float alpha_cutoff;
+    unsigned int bindings_count;
+    CachedBinding bindings[TEXTURE_TYPES_COUNT];
+} CachedMesh;
+
+// The content hash of the encoded image is kept, so a cache hit deduplicates textures without reading the images.
+// An edited image changes the source mtime, which invalidates the whole cache
+typedef struct CachedTexture {
+    unsigned long long int content_hash;
+    TextureType type;
+    TextureParams texture_params;
+    unsigned int path_offset;
+} CachedTexture;
+
+// Read-only view of a mapped cache file
+typedef struct MeshCache {
+    void* data;
+    size_t size;
+    MeshCacheHeader* header;
+    void* vertices;
+    unsigned int* indices;
+    CachedMesh* meshes;
+    CachedTexture* textures;
+    char* strings;
+} MeshCache;
+
+/* DECLARATIONS */
+
+unsigned long long int get_source_mtime(const char* source_path);
+char* get_mesh_cache_path(const char* source_path);
+MeshCache* open_mesh_cache(const char* source_path, unsigned int vertex_size);
+void close_mesh_cache(MeshCache* cache);
+bool write_mesh_cache(const char* source_path, MeshCacheHeader header, const void* vertices, const unsigned int* indices, const CachedMesh* meshes, const CachedTexture* textures, const char* strings);
+
+/* ----------------------------------------------- */
+
+static bool has_suffix(const char* name, const char* suffix) {
+    size_t name_length = strlen(name);
+    size_t suffix_length = strlen(suffix);
+    return name_length >= suffix_length && !strcmp(name + name_length - suffix_length, suffix);
+}
+
+// Newest modification time of the files in the directory and its subdirectories, down to MESH_CACHE_SCAN_DEPTH levels.
+// The texture caches are written next to their images, they would invalidate the mesh cache every time one is rebuilt,
+// and so would the directories, whose own mtime changes whenever one is created
+static unsigned long long int get_directory_mtime(const char* directory_path, unsigned long long int mtime, unsigned int depth) {
+    DIR* directory = opendir(directory_path);
+    if (directory == NULL) return mtime;
+
+    char entry_path[512];
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        if (!strcmp(entry -> d_name, ".") || !strcmp(entry -> d_name, "..")) continue;
+        if (has_suffix(entry -> d_name, TEXTURE_CACHE_EXTENSION) || has_suffix(entry -> d_name, TEXTURE_CACHE_EXTENSION ".tmp")) continue;
+        snprintf(entry_path, sizeof(entry_path), "%s/%s", directory_path, entry -> d_name);
+        struct stat entry_stat;
+        if (stat(entry_path, &entry_stat)) continue;
+        if (S_ISDIR(entry_stat.st_mode)) {
+            if (depth > 1) mtime = get_directory_mtime(entry_path, mtime, depth - 1);
+        } else if ((unsigned long long int) entry_stat.st_mtime > mtime) mtime = entry_stat.st_mtime;
+    }
+    closedir(directory);
+
+    return mtime;
+}
+
+// Newest modification time of the source and of the files it may reference.
+// A glTF file names its buffers and images with paths relative to its own directory, so for a file the scan covers
+// the directory holding it: editing a .bin or an image invalidates the cache as well
+unsigned long long int get_source_mtime(const char* source_path) {
+    struct stat source_stat;
+    if (stat(source_path, &source_stat)) return 0;
+
+    if (S_ISDIR(source_stat.st_mode)) return get_directory_mtime(source_path, 0, MESH_CACHE_SCAN_DEPTH);
+
+    unsigned long long int mtime = source_stat.st_mtime;
+
+    char* directory = get_directory((char*) source_path);
+    mtime = get_directory_mtime(directory[0] != '\0' ? directory : ".", mtime, MESH_CACHE_SCAN_DEPTH);
+    free(directory);
+
+    return mtime;
+}
+
+char* get_mesh_cache_path(const char* source_path) {
+    char* cache_path = (char*) calloc(sizeof(MESH_CACHE_DIRECTORY) + 24, sizeof(char));
+    snprintf(cache_path, sizeof(MESH_CACHE_DIRECTORY) + 24, MESH_CACHE_DIRECTORY "%016llx.mesh", fnv1a_hash(source_path, strlen(source_path), FNV1A_OFFSET_BASIS));
+    return cache_path;
+}
+
+// The section lies inside the file and starts aligned, written so that a huge count cannot overflow
+static bool is_cache_section_valid(unsigned long long int offset, unsigned long long int count, unsigned long long int element_size, size_t file_size) {
+    if (offset % MESH_CACHE_ALIGNMENT || offset > file_size) return FALSE;
+    return count <= (file_size - offset) / element_size;
+}
+
+// Every offset, count and index read from the file is checked before any of them is used,
+// a corrupted or foreign file of the right size would otherwise make the loader read past the mapping
+static bool is_mesh_cache_consistent(const unsigned char* data, size_t file_size) {
+    const MeshCacheHeader* header = (const MeshCacheHeader*) data;
+    if (header -> vertex_size == 0) return FALSE;
+    if (!is_cache_section_valid(header -> vertices_offset, header -> vertices_count, header -> vertex_size, file_size)) return FALSE;
+    if (!is_cache_section_valid(header -> indices_offset, header -> indices_count, sizeof(unsigned int), file_size)) return FALSE;
+    if (!is_cache_section_valid(header -> meshes_offset, header -> meshes_count, sizeof(CachedMesh), file_size)) return FALSE;
+    if (!is_cache_section_valid(header -> textures_offset, header -> textures_count, sizeof(CachedTexture), file_size)) return FALSE;
+    if (!is_cache_section_valid(header -> strings_offset, header -> strings_size, sizeof(char), file_size)) return FALSE;
+
+    // Each path is NUL terminated, so the last byte of the section has to be one
+    const char* strings = (const char*) data + header -> strings_offset;
+    if (header -> strings_size && strings[header -> strings_size - 1] != '\0') return FALSE;
+
+    const CachedTexture* textures = (const CachedTexture*) (data + header -> textures_offset);
+    for (unsigned int i = 0; i < header -> textures_count; ++i) {
+        if ((unsigned int) textures[i].type >= TEXTURE_TYPES_COUNT || textures[i].path_offset >= header -> strings_size) return FALSE;
+    }
+
+    const CachedMesh* meshes = (const CachedMesh*) (data + header -> meshes_offset);
+    for (unsigned int i = 0; i < header -> meshes_count; ++i) {
+        const CachedMesh* mesh = meshes + i;
+        if (mesh -> base_vertex < 0 || (unsigned long long int) mesh -> base_vertex + mesh -> vertices_count > header -> vertices_count) return FALSE;
+        if ((unsigned long long int) mesh -> first_index + mesh -> indices_count > header -> indices_count) return FALSE;
+        if (mesh -> bindings_count > TEXTURE_TYPES_COUNT) return FALSE;
+        for (unsigned int j = 0; j < mesh -> bindings_count; ++j) {
+            if (mesh -> bindings[j].unit >= TEXTURE_TYPES_COUNT || mesh -> bindings[j].texture_index >= header -> textures_count) return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+// Returns NULL when the cache is missing, stale, corrupted or was written by an incompatible build
+MeshCache* open_mesh_cache(const char* source_path, unsigned int vertex_size) {
+    // The buffers are uploaded as soon as the cache is open, so the whole file is prefetched
+    FileView file = {0};
+    char* cache_path = get_mesh_cache_path(source_path);
+    bool is_mapped = map_file(cache_path, FILE_ACCESS_PREFETCH, &file);
+    free(cache_path);
+    if (!is_mapped) return NULL;
+
+    if (file.size < sizeof(MeshCacheHeader)) {
+        unmap_file(&file);
+        return NULL;
+    }
+
+    void* data = (void*) (file.data);
+    MeshCacheHeader* header = (MeshCacheHeader*) data;
+    bool is_valid = header -> magic == MESH_CACHE_MAGIC && header -> version == MESH_CACHE_VERSION && header -> vertex_size == vertex_size;
+    is_valid = is_valid && header -> file_size == file.size;
+    is_valid = is_valid && header -> source_hash == fnv1a_hash(source_path, strlen(source_path), FNV1A_OFFSET_BASIS);
+    is_valid = is_valid && header -> source_mtime == get_source_mtime(source_path);
+    if (!is_valid) {
+        debug_info("mesh cache for '%s' is stale, rebuilding it\n", source_path);
+        unmap_file(&file);
+        return NULL;
+    }
+
+    if (!is_mesh_cache_consistent(data, file.size)) {
+        error_info("mesh cache for '%s' is corrupted, rebuilding it\n", source_path);
+        unmap_file(&file);
+        return NULL;
+    }
+
+    MeshCache* cache = (MeshCache*) calloc(1, sizeof(MeshCache));
+    cache -> data = data;
+    cache -> size = file.size;
+    cache -> header = header;
+    cache -> vertices = (unsigned char*) data + header -> vertices_offset;
+    cache -> indices = (unsigned int*) ((unsigned char*) data + header -> indices_offset);
+    cache -> meshes = (CachedMesh*) ((unsigned char*) data + header -> meshes_offset);
+    cache -> textures = (CachedTexture*) ((unsigned char*) data + header -> textures_offset);
+    cache -> strings = (char*) data + header -> strings_offset;
+
+    return cache;
+}
+
+void close_mesh_cache(MeshCache* cache) {
+    if (cache == NULL) return;
+    unmap_file(&(FileView) { .data = cache -> data, .size = cache -> size });
+    free(cache);
+    return;
+}
+
+static bool write_cache_section(FILE* file, unsigned long long int offset, const void* data, size_t size) {
+    if (fseek(file, offset, SEEK_SET)) return FALSE;
+    return fwrite(data, 1, size, file) == size;
+}
+
+// The counts of the header must be set, the offsets are filled here.
+// The file is written under a temporary name and renamed, so a reader never maps a partial cache.
+bool write_mesh_cache(const char* source_path, MeshCacheHeader header, const void* vertices, const unsigned int* indices, const CachedMesh* meshes, const CachedTexture* textures, const char* strings) {
+    mkdir(MESH_CACHE_DIRECTORY, 0755);
+
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.source_hash = fnv1a_hash(source_path, strlen(source_path), FNV1A_OFFSET_BASIS);
+    header.source_mtime = get_source_mtime(source_path);
+    header.vertices_offset = ALIGN_CACHE_OFFSET(sizeof(MeshCacheHeader));
+    header.indices_offset = ALIGN_CACHE_OFFSET(header.vertices_offset + (unsigned long long int) header.vertices_count * header.vertex_size);
+    header.meshes_offset = ALIGN_CACHE_OFFSET(header.indices_offset + (unsigned long long int) header.indices_count * sizeof(unsigned int));
+    header.textures_offset = ALIGN_CACHE_OFFSET(header.meshes_offset + (unsigned long long int) header.meshes_count * sizeof(CachedMesh));
+    header.strings_offset = ALIGN_CACHE_OFFSET(header.textures_offset + (unsigned long long int) header.textures_count * sizeof(CachedTexture));
+    header.file_size = header.strings_offset + header.strings_size;
+
+    char* cache_path = get_mesh_cache_path(source_path);
+    char* temp_path = (char*) calloc(strlen(cache_path) + 5, sizeof(char));
+    sprintf(temp_path, "%s.tmp", cache_path);
+
+    FILE* file = fopen(temp_path, "wb");
+    bool is_written = file != NULL;
+    if (is_written) {
+        is_written = write_cache_section(file, 0, &header, sizeof(MeshCacheHeader));
+        is_written = is_written && write_cache_section(file, header.vertices_offset, vertices, (size_t) header.vertices_count * header.vertex_size);
+        is_written = is_written && write_cache_section(file, header.indices_offset, indices, header.indices_count * sizeof(unsigned int));
+        is_written = is_written && write_cache_section(file, header.meshes_offset, meshes, header.meshes_count * sizeof(CachedMesh));
+        is_written = is_written && write_cache_section(file, header.textures_offset, textures, header.textures_count * sizeof(CachedTexture));
+        is_written = is_written && write_cache_section(file, header.strings_offset, strings, header.strings_size);
+        is_written = (fclose(file) == 0) && is_written;
+    }
+
+    if (is_written) is_written = rename(temp_path, cache_path) == 0;
+    else remove(temp_path);
+
+    if (is_written) debug_info("mesh cache written to '%s' (%llu bytes)\n", cache_path, header.file_size);
+    else error_info("failed to write the mesh cache '%s'\n", cache_path);
+
+    free(temp_path);
+    free(cache_path);
+
+    return is_written;
+}
+
+#endif //_MESH_CACHE_H_
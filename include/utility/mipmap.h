@@ -0,0 +1,294 @@
+#ifndef _MIPMAP_H_
+#define _MIPMAP_H_
+
+#include <pthread.h>
+#include "./types.h"
+#include "./utils.h"
+#include "./simd.h"
+#include "./thread_pool.h"
+
+// Gamma-correct 2x2 box filter for 8 bit images.
+// The color channels of sRGB images are averaged as linear light: every texel goes through a table to 14 bit linear values,
+// the rounded average of the four is mapped back through the inverse table. Linear channels (and alpha) are averaged as they are.
+// The whole filter is integer math, so the SIMD path matches the scalar reference bit for bit.
+
+#define LINEAR_BITS 14
+#define LINEAR_MAX ((1 << LINEAR_BITS) - 1)
+
+// Destination rows filtered by each job when a level is split over the worker pool
+#define MIP_ROWS_PER_JOB 32
+
+// Band of destination rows of a level
+typedef struct MipJob {
+    const unsigned char* src;
+    unsigned int src_width;
+    unsigned int src_height;
+    unsigned char* dest;
+    unsigned int components;
+    bool is_srgb;
+    unsigned int first_row;
+    unsigned int rows_count;
+} MipJob;
+
+/* DECLARATIONS */
+
+void generate_mip_level(const unsigned char* src, unsigned int src_width, unsigned int src_height, unsigned char* dest, unsigned int components, bool is_srgb);
+void generate_mip_level_reference(const unsigned char* src, unsigned int src_width, unsigned int src_height, unsigned char* dest, unsigned int components, bool is_srgb);
+bool verify_mip_generator(Image image, bool is_srgb);
+
+/* ----------------------------------------------- */
+
+// The identity tables let the sRGB path run the linear channels through the same loop
+static unsigned short int srgb_to_linear_table[256];
+static unsigned short int identity_to_table[256];
+static unsigned char linear_to_srgb_table[LINEAR_MAX + 1];
+static unsigned char identity_from_table[256];
+static pthread_once_t mip_tables_once = PTHREAD_ONCE_INIT;
+
+static void init_mip_tables(void) {
+    for (unsigned int i = 0; i < 256; ++i) {
+        double value = i / 255.0;
+        double linear = value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+        srgb_to_linear_table[i] = (unsigned short int) (linear * LINEAR_MAX + 0.5);
+        identity_to_table[i] = i;
+        identity_from_table[i] = i;
+    }
+
+    for (unsigned int i = 0; i <= LINEAR_MAX; ++i) {
+        double linear = (double) i / LINEAR_MAX;
+        double srgb = linear <= 0.0031308 ? linear * 12.92 : 1.055 * pow(linear, 1.0 / 2.4) - 0.055;
+        linear_to_srgb_table[i] = (unsigned char) (srgb * 255.0 + 0.5);
+    }
+
+    return;
+}
+
+// Alpha is the last channel of two and four components images, it is never gamma encoded
+static void get_channel_tables(unsigned int components, bool is_srgb, const unsigned short int** to_linear, const unsigned char** from_linear) {
+    for (unsigned int c = 0; c < components; ++c) {
+        bool is_color = components == 2 ? c == 0 : c < 3;
+        to_linear[c] = (is_srgb && is_color) ? srgb_to_linear_table : identity_to_table;
+        from_linear[c] = (is_srgb && is_color) ? linear_to_srgb_table : identity_from_table;
+    }
+    return;
+}
+
+static void filter_mip_rows_reference(MipJob* job) {
+    const unsigned short int* to_linear[4];
+    const unsigned char* from_linear[4];
+    get_channel_tables(job -> components, job -> is_srgb, to_linear, from_linear);
+
+    unsigned int dest_width = job -> src_width > 1 ? job -> src_width / 2 : 1;
+    unsigned int components = job -> components;
+    for (unsigned int y = job -> first_row; y < job -> first_row + job -> rows_count; ++y) {
+        const unsigned char* row0 = job -> src + (unsigned long long int) (2 * y < job -> src_height ? 2 * y : job -> src_height - 1) * job -> src_width * components;
+        const unsigned char* row1 = job -> src + (unsigned long long int) (2 * y + 1 < job -> src_height ? 2 * y + 1 : job -> src_height - 1) * job -> src_width * components;
+        for (unsigned int x = 0; x < dest_width; ++x) {
+            unsigned int x0 = (2 * x < job -> src_width ? 2 * x : job -> src_width - 1) * components;
+            unsigned int x1 = (2 * x + 1 < job -> src_width ? 2 * x + 1 : job -> src_width - 1) * components;
+            for (unsigned int c = 0; c < components; ++c) {
+                unsigned int sum = to_linear[c][row0[x0 + c]] + to_linear[c][row0[x1 + c]] + to_linear[c][row1[x0 + c]] + to_linear[c][row1[x1 + c]];
+                job -> dest[((unsigned long long int) y * dest_width + x) * components + c] = from_linear[c][(sum + 2) >> 2];
+            }
+        }
+    }
+
+    return;
+}
+
+// Without gamma every channel is a plain average of bytes, sixteen source bytes per iteration
+static void filter_linear_mip_rows(MipJob* job) {
+    unsigned int components = job -> components;
+    unsigned int src_row_size = job -> src_width * components;
+    unsigned int dest_width = job -> src_width > 1 ? job -> src_width / 2 : 1;
+    unsigned int dest_row_size = dest_width * components;
+    unsigned short int* sums = (unsigned short int*) malloc((src_row_size + 8) * sizeof(unsigned short int));
+
+    for (unsigned int y = job -> first_row; y < job -> first_row + job -> rows_count; ++y) {
+        const unsigned char* row0 = job -> src + (unsigned long long int) (2 * y < job -> src_height ? 2 * y : job -> src_height - 1) * src_row_size;
+        const unsigned char* row1 = job -> src + (unsigned long long int) (2 * y + 1 < job -> src_height ? 2 * y + 1 : job -> src_height - 1) * src_row_size;
+        unsigned char* dest = job -> dest + (unsigned long long int) y * dest_row_size;
+
+        unsigned int x = 0;
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+        // Four texels of each row give two destination texels
+        if (components == 4 && job -> src_width > 1) {
+            __m128i zero = _mm_setzero_si128();
+            __m128i two = _mm_set1_epi16(2);
+            for (; x + 2 <= dest_width; x += 2) {
+                __m128i a = _mm_loadu_si128((const __m128i*) (row0 + x * 8));
+                __m128i b = _mm_loadu_si128((const __m128i*) (row1 + x * 8));
+                __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                __m128i average = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+                _mm_storel_epi64((__m128i*) (dest + x * 4), _mm_packus_epi16(average, zero));
+            }
+        }
+#endif
+
+        // Vertical sums first, then the texel pairs
+        if (x < dest_width) {
+            unsigned int i = 2 * x * components;
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+            __m128i zero = _mm_setzero_si128();
+            for (; i + 8 <= src_row_size; i += 8) {
+                __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (row0 + i)), zero);
+                __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (row1 + i)), zero);
+                _mm_storeu_si128((__m128i*) (sums + i), _mm_add_epi16(a, b));
+            }
+#elif defined(_SIMD_NEON_)
+            for (; i + 8 <= src_row_size; i += 8) vst1q_u16(sums + i, vaddl_u8(vld1_u8(row0 + i), vld1_u8(row1 + i)));
+#endif
+            for (; i < src_row_size; ++i) sums[i] = row0[i] + row1[i];
+        }
+        for (; x < dest_width; ++x) {
+            unsigned int x0 = (2 * x < job -> src_width ? 2 * x : job -> src_width - 1) * components;
+            unsigned int x1 = (2 * x + 1 < job -> src_width ? 2 * x + 1 : job -> src_width - 1) * components;
+            for (unsigned int c = 0; c < components; ++c) dest[x * components + c] = (sums[x0 + c] + sums[x1 + c] + 2) >> 2;
+        }
+    }
+
+    free(sums);
+
+    return;
+}
+
+// The table lookups dominate with gamma, so the sRGB path stays texel by texel: the tables of the four channels are held
+// in locals (the byte stores would otherwise force them to be reloaded) and the border clamps are left out of the inner loop
+static void filter_mip_rows(MipJob* job) {
+    if (!(job -> is_srgb)) {
+        filter_linear_mip_rows(job);
+        return;
+    }
+
+    const unsigned short int* to_linear[4] = {0};
+    const unsigned char* from_linear[4] = {0};
+    get_channel_tables(job -> components, job -> is_srgb, to_linear, from_linear);
+    const unsigned short int* to0 = to_linear[0];
+    const unsigned short int* to1 = job -> components > 1 ? to_linear[1] : to0;
+    const unsigned short int* to2 = job -> components > 2 ? to_linear[2] : to0;
+    const unsigned short int* to3 = job -> components > 3 ? to_linear[3] : to0;
+    const unsigned char* from0 = from_linear[0];
+    const unsigned char* from1 = job -> components > 1 ? from_linear[1] : from0;
+    const unsigned char* from2 = job -> components > 2 ? from_linear[2] : from0;
+    const unsigned char* from3 = job -> components > 3 ? from_linear[3] : from0;
+
+    unsigned int components = job -> components;
+    unsigned int src_row_size = job -> src_width * components;
+    unsigned int dest_width = job -> src_width > 1 ? job -> src_width / 2 : 1;
+    unsigned int dest_row_size = dest_width * components;
+
+    // A single column is averaged with itself
+    unsigned int step = job -> src_width > 1 ? components : 0;
+
+    for (unsigned int y = job -> first_row; y < job -> first_row + job -> rows_count; ++y) {
+        const unsigned char* row0 = job -> src + (unsigned long long int) (2 * y < job -> src_height ? 2 * y : job -> src_height - 1) * src_row_size;
+        const unsigned char* row1 = job -> src + (unsigned long long int) (2 * y + 1 < job -> src_height ? 2 * y + 1 : job -> src_height - 1) * src_row_size;
+        unsigned char* dest = job -> dest + (unsigned long long int) y * dest_row_size;
+
+        #define AVERAGE_LINEAR(to, i) ((to[row0[i]] + to[row0[(i) + step]] + to[row1[i]] + to[row1[(i) + step]] + 2) >> 2)
+        for (unsigned int x = 0, i = 0; x < dest_width; ++x, i += 2 * components, dest += components) {
+            switch (components) {
+                case 4: dest[3] = from3[AVERAGE_LINEAR(to3, i + 3)]; // fall through
+                case 3: dest[2] = from2[AVERAGE_LINEAR(to2, i + 2)]; // fall through
+                case 2: dest[1] = from1[AVERAGE_LINEAR(to1, i + 1)]; // fall through
+                default: dest[0] = from0[AVERAGE_LINEAR(to0, i)];
+            }
+        }
+        #undef AVERAGE_LINEAR
+    }
+
+    return;
+}
+
+static void filter_mip_rows_job(void* args) {
+    filter_mip_rows((MipJob*) args);
+    return;
+}
+
+// Halves both sides (down to 1), an odd last row or column is left out of the average.
+// Large levels are split in bands of rows over the worker pool, the calling thread filters too while it waits
+void generate_mip_level(const unsigned char* src, unsigned int src_width, unsigned int src_height, unsigned char* dest, unsigned int components, bool is_srgb) {
+    pthread_once(&mip_tables_once, init_mip_tables);
+
+    unsigned int dest_height = src_height > 1 ? src_height / 2 : 1;
+    unsigned int jobs_count = (dest_height + MIP_ROWS_PER_JOB - 1) / MIP_ROWS_PER_JOB;
+
+    MipJob* jobs = (MipJob*) calloc(jobs_count, sizeof(MipJob));
+    for (unsigned int i = 0; i < jobs_count; ++i) {
+        unsigned int first_row = i * MIP_ROWS_PER_JOB;
+        jobs[i] = (MipJob) {
+            .src = src, .src_width = src_width, .src_height = src_height, .dest = dest, .components = components, .is_srgb = is_srgb,
+            .first_row = first_row, .rows_count = (dest_height - first_row) < MIP_ROWS_PER_JOB ? (dest_height - first_row) : MIP_ROWS_PER_JOB
+        };
+    }
+
+    if (jobs_count == 1) filter_mip_rows(jobs);
+    else {
+        JobGroup group = {0};
+        for (unsigned int i = 0; i < jobs_count; ++i) submit_group_job(get_worker_pool(), &group, filter_mip_rows_job, jobs + i);
+        help_group(get_worker_pool(), &group);
+    }
+
+    free(jobs);
+
+    return;
+}
+
+// Single threaded, texel by texel, the reference generate_mip_level must match
+void generate_mip_level_reference(const unsigned char* src, unsigned int src_width, unsigned int src_height, unsigned char* dest, unsigned int components, bool is_srgb) {
+    pthread_once(&mip_tables_once, init_mip_tables);
+    MipJob job = { .src = src, .src_width = src_width, .src_height = src_height, .dest = dest, .components = components, .is_srgb = is_srgb, .first_row = 0 };
+    job.rows_count = src_height > 1 ? src_height / 2 : 1;
+    filter_mip_rows_reference(&job);
+    return;
+}
+
+// Builds the whole chain with both generators and compares every level, reporting the time of each
+bool verify_mip_generator(Image image, bool is_srgb) {
+    unsigned int components = image.components;
+    unsigned long long int level_size = (unsigned long long int) image.width * image.height * components;
+    unsigned char* levels[2][2] = { { (unsigned char*) malloc(level_size), (unsigned char*) malloc(level_size) }, { (unsigned char*) malloc(level_size), (unsigned char*) malloc(level_size) } };
+    double times[2] = {0};
+    bool is_exact = TRUE;
+
+    const unsigned char* src[2] = { image.decoded_data, image.decoded_data };
+    unsigned int width = image.width;
+    unsigned int height = image.height;
+    for (unsigned int level = 1; width > 1 || height > 1; ++level) {
+        unsigned int dest_width = width > 1 ? width / 2 : 1;
+        unsigned int dest_height = height > 1 ? height / 2 : 1;
+
+        double start = get_wall_time();
+        generate_mip_level(src[0], width, height, levels[0][level & 1], components, is_srgb);
+        times[0] += get_wall_time() - start;
+
+        start = get_wall_time();
+        generate_mip_level_reference(src[1], width, height, levels[1][level & 1], components, is_srgb);
+        times[1] += get_wall_time() - start;
+
+        if (memcmp(levels[0][level & 1], levels[1][level & 1], (unsigned long long int) dest_width * dest_height * components)) {
+            error_info("mip level %u (%ux%u) differs from the reference\n", level, dest_width, dest_height);
+            is_exact = FALSE;
+            break;
+        }
+
+        src[0] = levels[0][level & 1];
+        src[1] = levels[1][level & 1];
+        width = dest_width;
+        height = dest_height;
+    }
+
+    debug_info("%ux%u, %u components, %s: mip chain %.2f ms, reference %.2f ms, %s\n", image.width, image.height, components, is_srgb ? "sRGB" : "linear", times[0] * 1000.0, times[1] * 1000.0, is_exact ? "bit exact" : "MISMATCH");
+
+    for (unsigned int i = 0; i < 2; ++i) {
+        free(levels[i][0]);
+        free(levels[i][1]);
+    }
+
+    return is_exact;
+}
+
+#endif //_MIPMAP_H_
@@ -4,8 +4,17 @@
 #include <stddef.h>
 #include "./utils.h"
 #include "./texture.h"
+#include "./texture_registry.h"
+#include "./hash_map.h"
 #include "./matrix.h"
+#include "./shader.h"
+#include "./shader_variants.h"
+#include "./extensions.h"
 #include "../../libs/gltf_header.h"
+#include "./convert.h"
+#include "./thread_pool.h"
+#include "./mesh_cache.h"
+#include "./profiler.h"
 
 typedef struct Vertex {
     float position[3];
@@ -14,45 +23,124 @@ typedef struct Vertex {
     float tangent[4];
 } Vertex;
 
+// Reference of the model to a shared texture
 typedef struct ModelTexture {
     unsigned int id;
-    char* type;
+    TextureType type;
+    TextureParams texture_params;
     char* path;
+    TextureEntry* entry;
 } ModelTexture;
 
+// Texture bound to a texture unit when drawing a mesh, resolved at load time
+typedef struct MaterialBinding {
+    unsigned int unit;
+    unsigned int texture_id;
+} MaterialBinding;
+
+#define DRAW_ID_ATTRIBUTE 4
+
+// Layout of a glMultiDrawElementsIndirect command
+typedef struct DrawElementsIndirectCommand {
+    unsigned int count;
+    unsigned int instance_count;
+    unsigned int first_index;
+    int base_vertex;
+    unsigned int base_instance;
+} DrawElementsIndirectCommand;
+
+// Consecutive indirect commands whose meshes share the same material
+typedef struct IndirectBatch {
+    MaterialBinding bindings[TEXTURE_TYPES_COUNT];
+    unsigned int bindings_count;
+    unsigned int features;
+    float alpha_cutoff;
+    unsigned int first_command;
+    unsigned int commands_count;
+} IndirectBatch;
+
+// Range of the model buffers used by the mesh, the features select the shader variant drawing it
 typedef struct ModelMesh {
-    unsigned int* VAO;
-    unsigned int* VBO;
-    unsigned int* EBO;
+    int base_vertex;
+    unsigned int first_index;
     Vertex* vertices;
     unsigned int vertices_count;
-    Array textures;
+    MaterialBinding bindings[TEXTURE_TYPES_COUNT];
+    unsigned int bindings_count;
+    unsigned int features;
+    float alpha_cutoff;
     unsigned int* indices;
     unsigned int indices_count;
-    Matrix transformation_matrix;
+    Mat4 transformation_matrix;
     Vector translation_mat;
     Quaternion rotation_mat;
     Vector scale_mat;
+    unsigned int mesh_index;
+    bool is_resident;
 } ModelMesh;
 
+// Conversion of one scene mesh, processed by the worker threads and uploaded into its range of the model buffers
+typedef struct MeshJob {
+    Mesh mesh;
+    ModelMesh* result;
+    int base_vertex;
+    unsigned int first_index;
+    unsigned int vertices_count;
+    unsigned int indices_count;
+    bool is_converted;
+    bool is_uploaded;
+} MeshJob;
+
+// All the meshes of a model share a single vertex and index buffer
 typedef struct Model {
+    unsigned int VAO;
+    unsigned int VBO;
+    unsigned int EBO;
+    unsigned int vertices_count;
+    unsigned int indices_count;
+    unsigned int indirect_buffer;
+    unsigned int draw_ids_buffer;
+    unsigned int transforms_buffer;
+    unsigned int transforms_texture;
+    IndirectBatch* batches;
+    unsigned int batches_count;
     Array meshes;
+    Array textures;
+    HashMap textures_map;
+    char* texture_paths;
     char* directory;
 } Model;
 
-void setup_mesh(ModelMesh* mesh) {
-    glGenVertexArrays(1, mesh -> VAO);
-    glGenBuffers(1, mesh -> VBO);
-    glGenBuffers(1, mesh -> EBO);
-
-    glBindVertexArray(*(mesh -> VAO));
-
-    glBindBuffer(GL_ARRAY_BUFFER, *(mesh -> VBO));
-    glBufferData(GL_ARRAY_BUFFER, (mesh -> vertices_count) * sizeof(Vertex), (mesh -> vertices) -> position, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *(mesh -> EBO));
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (mesh -> indices_count) * sizeof(unsigned int), mesh -> indices, GL_STATIC_DRAW);
+typedef enum ModelState { MODEL_PARSING, MODEL_STREAMING, MODEL_READY, MODEL_FAILED } ModelState;
 
+// Model loaded in the background: parsing and conversion run on the worker pool, poll_model streams the results to GL.
+// When a valid mesh cache exists the parse is skipped and the mapped cache is uploaded as is.
+typedef struct ModelLoader {
+    char* path;
+    ModelState state;
+    Scene scene;
+    MeshJob* mesh_jobs;
+    JobGroup jobs;
+    Model* model;
+    MeshCache* cache;
+    HashMap content_hashes;
+    unsigned int uploaded_meshes;
+    TextureQueue texture_queue;
+    double start_time;
+    double parse_time;
+} ModelLoader;
+
+// Shown by a texture until its image is uploaded: neutral base color, roughness 1 and metallic 0, flat normal, no occlusion nor emission
+static const unsigned char placeholder_texels[TEXTURE_TYPES_COUNT][4] = {
+    [BASE_COLOR_TEXTURE] = { 255, 255, 255, 255 },
+    [METALLIC_ROUGHNESS_TEXTURE] = { 0, 255, 0, 255 },
+    [NORMAL_TEXTURE] = { 128, 128, 255, 255 },
+    [OCCLUSION_TEXTURE] = { 255, 255, 255, 255 },
+    [EMISSIVE_TEXTURE] = { 0, 0, 0, 255 }
+};
+
+// Describe the Vertex layout of the bound GL_ARRAY_BUFFER to the bound VAO
+void setup_vertex_attributes(void) {
     // vertex positions
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) 0);
@@ -69,6 +157,41 @@ void setup_mesh(ModelMesh* mesh) {
     glEnableVertexAttribArray(3);
     glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, tangent));
 
+    return;
+}
+
+// Reserve the shared buffers for every mesh of the model, without initial data each mesh is then uploaded into its range
+void allocate_model_buffers(Model* model, const void* vertices, const unsigned int* indices) {
+    glGenVertexArrays(1, &(model -> VAO));
+    glGenBuffers(1, &(model -> VBO));
+    glGenBuffers(1, &(model -> EBO));
+
+    glBindVertexArray(model -> VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, model -> VBO);
+    glBufferData(GL_ARRAY_BUFFER, (model -> vertices_count) * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model -> EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (model -> indices_count) * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+
+    setup_vertex_attributes();
+
+    glBindVertexArray(0); // Unbind VAO
+    glBindBuffer(GL_ARRAY_BUFFER, 0); // Unbind VBO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // Unbind EBO
+
+    return;
+}
+
+void upload_mesh(Model* model, MeshJob* job) {
+    glBindVertexArray(model -> VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, model -> VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, (job -> base_vertex) * sizeof(Vertex), (job -> vertices_count) * sizeof(Vertex), job -> result -> vertices);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model -> EBO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (job -> first_index) * sizeof(unsigned int), (job -> indices_count) * sizeof(unsigned int), job -> result -> indices);
+
     glBindVertexArray(0); // Unbind VAO
     glBindBuffer(GL_ARRAY_BUFFER, 0); // Unbind VBO
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // Unbind EBO
@@ -76,223 +199,759 @@ void setup_mesh(ModelMesh* mesh) {
     return;
 }
 
-void deallocate_mesh(ModelMesh mesh) {
-    free(mesh.vertices);
-    deallocate_arr(mesh.textures);
-    free(mesh.indices);
-    DEALLOCATE_MATRICES(mesh.transformation_matrix, mesh.translation_mat, mesh.rotation_mat, mesh.scale_mat);
-    glDeleteVertexArrays(1, mesh.VAO);
-    glDeleteBuffers(1, mesh.VBO);
-    glDeleteBuffers(1, mesh.EBO);
+static bool same_material(IndirectBatch* batch, ModelMesh* mesh) {
+    if (batch -> features != mesh -> features || batch -> alpha_cutoff != mesh -> alpha_cutoff) return FALSE;
+    return (batch -> bindings_count == mesh -> bindings_count) && !memcmp(batch -> bindings, mesh -> bindings, mesh -> bindings_count * sizeof(MaterialBinding));
+}
+
+// Build one indirect command per mesh, grouped by material, and the per-mesh transforms read by the INDIRECT variants.
+// The meshes are sorted by features, so are the batches.
+// Each command stores its mesh index in baseInstance, which reaches the shader through the instanced draw id attribute.
+void setup_model_indirect(Model* model) {
+    unsigned int meshes_count = model -> meshes.count;
+    DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*) calloc(meshes_count, sizeof(DrawElementsIndirectCommand));
+    unsigned int* draw_ids = (unsigned int*) calloc(meshes_count, sizeof(unsigned int));
+    unsigned int* mesh_batches = (unsigned int*) calloc(meshes_count, sizeof(unsigned int));
+    Mat4* transforms = (Mat4*) calloc(meshes_count, sizeof(Mat4));
+    model -> batches = (IndirectBatch*) calloc(meshes_count, sizeof(IndirectBatch));
+    model -> batches_count = 0;
+
+    // Assign each mesh to the batch of its material
+    for (unsigned int i = 0; i < meshes_count; ++i) {
+        ModelMesh* mesh = GET_ELEMENT(ModelMesh*, model -> meshes, i);
+        unsigned int batch = 0;
+        while (batch < model -> batches_count && !same_material(model -> batches + batch, mesh)) batch++;
+
+        if (batch == model -> batches_count) {
+            memcpy(model -> batches[batch].bindings, mesh -> bindings, sizeof(mesh -> bindings));
+            model -> batches[batch].bindings_count = mesh -> bindings_count;
+            model -> batches[batch].features = mesh -> features;
+            model -> batches[batch].alpha_cutoff = mesh -> alpha_cutoff;
+            model -> batches_count++;
+        }
+
+        model -> batches[batch].commands_count++;
+        mesh_batches[i] = batch;
+        draw_ids[i] = i;
+        transforms[i] = mesh -> transformation_matrix;
+    }
+
+    // Lay the batches out one after the other and fill their commands
+    for (unsigned int i = 1; i < model -> batches_count; ++i) {
+        model -> batches[i].first_command = model -> batches[i - 1].first_command + model -> batches[i - 1].commands_count;
+    }
+
+    for (unsigned int i = 0; i < model -> batches_count; ++i) {
+        model -> batches[i].commands_count = 0;
+    }
+
+    for (unsigned int i = 0; i < meshes_count; ++i) {
+        ModelMesh* mesh = GET_ELEMENT(ModelMesh*, model -> meshes, i);
+        IndirectBatch* batch = model -> batches + mesh_batches[i];
+        commands[batch -> first_command + (batch -> commands_count)++] = (DrawElementsIndirectCommand) {
+            .count = mesh -> indices_count,
+            .instance_count = 1,
+            .first_index = mesh -> first_index,
+            .base_vertex = mesh -> base_vertex,
+            .base_instance = i
+        };
+    }
+
+    glGenBuffers(1, &(model -> indirect_buffer));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, model -> indirect_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, meshes_count * sizeof(DrawElementsIndirectCommand), commands, GL_STATIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // The transforms are exposed to the shader as a buffer texture of RGBA32F texels, one per matrix row
+    glGenBuffers(1, &(model -> transforms_buffer));
+    glBindBuffer(GL_TEXTURE_BUFFER, model -> transforms_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, meshes_count * sizeof(Mat4), transforms, GL_STATIC_DRAW);
+    glGenTextures(1, &(model -> transforms_texture));
+    glBindTexture(GL_TEXTURE_BUFFER, model -> transforms_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, model -> transforms_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // draw ids, advanced once per instance so that baseInstance selects the mesh
+    glBindVertexArray(model -> VAO);
+    glGenBuffers(1, &(model -> draw_ids_buffer));
+    glBindBuffer(GL_ARRAY_BUFFER, model -> draw_ids_buffer);
+    glBufferData(GL_ARRAY_BUFFER, meshes_count * sizeof(unsigned int), draw_ids, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+    glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*) 0);
+    glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    free(commands);
+    free(draw_ids);
+    free(mesh_batches);
+    free(transforms);
+
+    return;
+}
+
+void deallocate_mesh(ModelMesh* mesh) {
+    free(mesh -> vertices);
+    free(mesh -> indices);
+    DEALLOCATE_MATRICES(mesh -> translation_mat, mesh -> rotation_mat, mesh -> scale_mat);
+    free(mesh);
     return;
 }
 
 void deallocate_model(Model* model) {
     debug_info("deallocating model...\n");
     for (unsigned int i = 0; i < model -> meshes.count; ++i) {
-        deallocate_mesh(*GET_ELEMENT(ModelMesh*, model -> meshes, i));
+        deallocate_mesh(GET_ELEMENT(ModelMesh*, model -> meshes, i));
+    }
+    deallocate_arr(model -> meshes);
+    glDeleteVertexArrays(1, &(model -> VAO));
+    glDeleteBuffers(1, &(model -> VBO));
+    glDeleteBuffers(1, &(model -> EBO));
+    glDeleteBuffers(1, &(model -> indirect_buffer));
+    glDeleteBuffers(1, &(model -> draw_ids_buffer));
+    glDeleteBuffers(1, &(model -> transforms_buffer));
+    glDeleteTextures(1, &(model -> transforms_texture));
+    free(model -> batches);
+    for (unsigned int i = 0; i < model -> textures.count; ++i) {
+        ModelTexture* texture = GET_ELEMENT(ModelTexture*, model -> textures, i);
+        release_texture(texture -> entry);
+        free(texture);
     }
+    deallocate_arr(model -> textures);
+    deallocate_hash_map(&(model -> textures_map));
+    free(model -> texture_paths);
     free(model -> directory);
     free(model);
     return;
 }
 
-void draw_mesh(unsigned int shader, ModelMesh* mesh, Camera* camera) {
-    unsigned int base_color_nr = 1;
-    unsigned int metallic_roughness_nr = 1;
-    unsigned int normal_nr = 1;
-    unsigned int occlusion_nr = 1;
-    unsigned int emissive_nr = 1;
-
-    for (unsigned int i = 0; i < (mesh -> textures).count; ++i) {
-        unsigned int number = 0;
-        char* name = (char*) (GET_ELEMENT(ModelTexture*, mesh -> textures, i) -> type);
-        glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-
-        if (!strcmp(name, "base_color_texture")) {
-            number = base_color_nr;
-            base_color_nr++;
-        } else if (!strcmp(name, "metallic_roughness_texture")) {
-            number = metallic_roughness_nr;
-            metallic_roughness_nr++;
-        } else if (!strcmp(name, "normal_texture")) {
-            number = normal_nr;
-            normal_nr++;
-        } else if (!strcmp(name, "occlusion_texture")) {
-            number = occlusion_nr;
-            occlusion_nr++;
-        } else if (!strcmp(name, "emissive_texture")) {
-            number = emissive_nr;
-            emissive_nr++;
-        }
-
-        char* material_id = (char*) calloc(1, sizeof(char));
-        concat(3, &material_id, "ssu", "material.", name, number);
-        set_int(shader, material_id, i, glUniform1i);
-        glBindTexture(GL_TEXTURE_2D, GET_ELEMENT(ModelTexture*, mesh -> textures, i) -> id);
-        free(material_id);
+void bind_material(MaterialBinding* bindings, unsigned int bindings_count) {
+    for (unsigned int i = 0; i < bindings_count; ++i) {
+        GL_CALL(glActiveTexture(GL_TEXTURE0 + bindings[i].unit));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, bindings[i].texture_id));
     }
+    return;
+}
 
-    set_vec(shader, "cam_pos", camera -> camera_pos.data, glUniform3fv);
-
-    // draw mesh
-    glBindVertexArray(*(mesh -> VAO));
-    glDrawElements(GL_TRIANGLES, mesh -> indices_count, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0); // Unbind VAO
+// NOTE: expects the VAO of the model to be bound
+void draw_mesh(ModelMesh* mesh) {
+    bind_material(mesh -> bindings, mesh -> bindings_count);
 
-    // Set back to default
-    glActiveTexture(GL_TEXTURE0);
+    GL_CALL(glDrawElementsBaseVertex(GL_TRIANGLES, mesh -> indices_count, GL_UNSIGNED_INT, (void*) ((mesh -> first_index) * sizeof(unsigned int)), mesh -> base_vertex));
 
     return;
 }
 
-void draw_model(unsigned int shader, Model* model, Camera* camera) {
+// Starts the build of every variant the meshes will be drawn with in one go, so the driver can compile them side by side
+void prepare_model_shaders(ShaderVariants* shaders, Model* model, unsigned int pipeline_features) {
+    unsigned int features = UINT32_MAX;
     for (unsigned int i = 0; i < model -> meshes.count; ++i) {
         ModelMesh* mesh = GET_ELEMENT(ModelMesh*, model -> meshes, i);
-        draw_mesh(shader, mesh, camera);
-        set_matrix(shader, "transform", mesh -> transformation_matrix.data, glUniformMatrix4fv);
+        if (mesh -> features == features) continue;
+        features = mesh -> features;
+        get_shader_variant(shaders, pipeline_features | features);
     }
     return;
 }
 
-static float* get_element_as_float(ArrayExtended arr_ext, unsigned int index) {
-    if (index >= arr_ext.arr.count) return NULL;
+// The meshes are sorted by features, so the program only changes once per variant
+void draw_model(ShaderVariants* shaders, Model* model) {
+    PROFILE_FUNCTION();
+    GL_CALL(glBindVertexArray(model -> VAO));
 
-    unsigned char size = elements_count[arr_ext.data_type];
-    void* data = GET_ELEMENT(void*, arr_ext.arr, index);
-
-    if ((arr_ext.component_type == BYTE) || (arr_ext.component_type == UNSIGNED_BYTE) || (arr_ext.component_type == SHORT) || (arr_ext.component_type == UNSIGNED_SHORT) || (arr_ext.component_type == UNSIGNED_INT)) {
-        float* element = (float*) calloc(size, sizeof(float));
-        for (unsigned int i = 0; i < size; ++i) {
-            if (arr_ext.component_type == BYTE) element[i] = ((char*) data)[i];
-            else if (arr_ext.component_type == UNSIGNED_BYTE) element[i] = ((unsigned char*) data)[i];
-            else if (arr_ext.component_type == SHORT) element[i] = ((short int*) data)[i];
-            else if (arr_ext.component_type == UNSIGNED_SHORT) element[i] = ((unsigned short int*) data)[i];
-            else if (arr_ext.component_type == UNSIGNED_INT) element[i] = ((unsigned int*) data)[i];
+    ShaderProgram* shader = NULL;
+    unsigned int features = UINT32_MAX;
+    for (unsigned int i = 0; i < model -> meshes.count; ++i) {
+        ModelMesh* mesh = GET_ELEMENT(ModelMesh*, model -> meshes, i);
+        if (!(mesh -> is_resident)) continue;
+        if (mesh -> features != features) {
+            features = mesh -> features;
+            shader = use_shader_variant(shaders, features);
         }
-        return element;
+        if (shader == NULL) continue;
+        set_uniform_float(shader -> alpha_cutoff, mesh -> alpha_cutoff);
+        set_uniform_mat4(shader -> transform, mesh -> transformation_matrix.data);
+        draw_mesh(mesh);
     }
 
-    return ((float*) data);
+    GL_CALL(glBindVertexArray(0)); // Unbind VAO
+
+    return;
 }
 
-ModelTexture* process_texture(Texture texture, char* type, Array* loaded_textures_arr) {
-    ModelTexture* model_texture = (ModelTexture*) calloc(1, sizeof(ModelTexture));
-    for (unsigned int i = 0; i < loaded_textures_arr -> count; ++i) {
-        ModelTexture loaded_texture = *GET_ELEMENT(ModelTexture*, *loaded_textures_arr, i);
-        if (!strcmp(loaded_texture.path, texture.texture_path)) {
-            *model_texture = loaded_texture;
-            return model_texture;
-        }
+// Submit every mesh with one glMultiDrawElementsIndirect per material, requires setup_model_indirect
+void draw_model_indirect(ShaderVariants* shaders, Model* model) {
+    PROFILE_FUNCTION();
+    GL_CALL(glBindVertexArray(model -> VAO));
+    GL_CALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, model -> indirect_buffer));
+    GL_CALL(glActiveTexture(GL_TEXTURE0 + MESH_TRANSFORMS_UNIT));
+    GL_CALL(glBindTexture(GL_TEXTURE_BUFFER, model -> transforms_texture));
+
+    for (unsigned int i = 0; i < model -> batches_count; ++i) {
+        IndirectBatch* batch = model -> batches + i;
+        ShaderProgram* shader = use_shader_variant(shaders, FEATURE_INDIRECT | batch -> features);
+        if (shader == NULL) continue;
+        set_uniform_float(shader -> alpha_cutoff, batch -> alpha_cutoff);
+        bind_material(batch -> bindings, batch -> bindings_count);
+        GL_CALL(glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*) ((batch -> first_command) * sizeof(DrawElementsIndirectCommand)), batch -> commands_count, 0));
+    }
+
+    GL_CALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+    GL_CALL(glBindVertexArray(0)); // Unbind VAO
+
+    return;
+}
+
+// Copies the converted attribute into the field at field_offset of each vertex, keeping at most field_size components
+static void unpack_attribute(ArrayExtended arr_ext, bool normalized, Vertex* vertices, size_t field_offset, unsigned int field_size) {
+    float* values = convert_attribute(arr_ext, normalized);
+    if (values == NULL) return;
+
+    unsigned int components = elements_count[arr_ext.data_type];
+    size_t copied = (components < field_size ? components : field_size) * sizeof(float);
+    for (unsigned int i = 0; i < arr_ext.arr.count; ++i) {
+        memcpy(((char*) (vertices + i)) + field_offset, values + i * components, copied);
     }
-    TextureParams texture_params = (TextureParams) {
+
+    free(values);
+
+    return;
+}
+
+static TextureParams get_texture_params(Texture texture) {
+    return (TextureParams) {
         .wrap_s = normalize_wrap_values[texture.wrap_s],
         .wrap_t = normalize_wrap_values[texture.wrap_t],
         .min_filter = normalize_filter_values[texture.min_filter],
         .mag_filter = normalize_filter_values[texture.mag_filter]
     };
-    load_texture(texture.texture_path, &(model_texture -> id), texture_params);
+}
+
+// The same path with another type or other params is another texture, as in the registry
+static unsigned long long int get_model_texture_key(const char* path, TextureType type, TextureParams texture_params) {
+    return fnv1a_hash(path, strlen(path), get_texture_usage_seed(type, texture_params));
+}
+
+static ModelTexture* find_loaded_texture(const char* path, TextureType type, TextureParams texture_params, Model* model) {
+    unsigned long long int index = 0;
+    if (!hash_map_get(&(model -> textures_map), get_model_texture_key(path, type, texture_params), &index)) return NULL;
+    ModelTexture* loaded_texture = GET_ELEMENT(ModelTexture*, model -> textures, index);
+    bool is_same = !strcmp(loaded_texture -> path, path) && loaded_texture -> type == type;
+    is_same = is_same && !memcmp(&(loaded_texture -> texture_params), &texture_params, sizeof(TextureParams));
+    return is_same ? loaded_texture : NULL;
+}
+
+// Takes a reference to the shared texture, which is only decoded if no model loaded the same path or file yet.
+// The id is valid right away and shows a placeholder until the decoded image is uploaded
+static ModelTexture* add_model_texture(char* path, unsigned long long int content_hash, TextureType type, TextureParams texture_params, ModelLoader* loader) {
+    Model* model = loader -> model;
+    ModelTexture* model_texture = (ModelTexture*) calloc(1, sizeof(ModelTexture));
+    model_texture -> entry = acquire_texture(path, content_hash, type, texture_params, placeholder_texels[type], &(loader -> texture_queue));
+    model_texture -> id = model_texture -> entry -> id;
     model_texture -> type = type;
-    model_texture -> path = texture.texture_path;
-    append_element(loaded_textures_arr, model_texture);
+    model_texture -> texture_params = texture_params;
+    model_texture -> path = path;
+    hash_map_put(&(model -> textures_map), get_model_texture_key(path, type, texture_params), model -> textures.count);
+    append_element(&(model -> textures), model_texture);
     return model_texture;
 }
 
-ModelMesh* process_mesh(Mesh mesh, Scene scene, Array* loaded_textures_arr) {
-    ModelMesh* model_mesh = (ModelMesh*) calloc(1, sizeof(ModelMesh));
-    model_mesh -> vertices = (Vertex*) calloc(1, sizeof(Vertex));
-    model_mesh -> vertices_count = 0;
-    model_mesh -> textures = init_arr();
-    model_mesh -> indices = (unsigned int*) calloc(1, sizeof(unsigned int));
-    model_mesh -> indices_count = 0;
-
-    for (unsigned int i = 0; i < mesh.vertices.arr.count; ++i, ++(model_mesh -> vertices_count)) {
-        model_mesh -> vertices = (Vertex*) realloc(model_mesh -> vertices, sizeof(Vertex) * (model_mesh -> vertices_count + 1));
-
-        float* position = get_element_as_float(mesh.vertices, i);
-        for (unsigned int j = 0; j < elements_count[mesh.vertices.data_type]; ++j) {
-            ((model_mesh -> vertices)[model_mesh -> vertices_count]).position[j] = position[j];
-        }
+// Queues the decode of a texture not seen yet
+unsigned int process_texture(Texture texture, TextureType type, ModelLoader* loader) {
+    TextureParams texture_params = get_texture_params(texture);
+    ModelTexture* loaded_texture = find_loaded_texture(texture.texture_path, type, texture_params, loader -> model);
+    if (loaded_texture != NULL) return loaded_texture -> id;
 
-        float* normal = get_element_as_float(mesh.normals, i);
-        for (unsigned int j = 0; j < elements_count[mesh.normals.data_type]; ++j) {
-            ((model_mesh -> vertices)[model_mesh -> vertices_count]).normal[j] = normal[j];
-        }
+    unsigned long long int content_hash = 0;
+    hash_map_get(&(loader -> content_hashes), fnv1a_hash(texture.texture_path, strlen(texture.texture_path), FNV1A_OFFSET_BASIS), &content_hash);
 
-        float* tangent = get_element_as_float(mesh.tangents, i);
-        for (unsigned int j = 0; j < elements_count[mesh.tangents.data_type]; ++j) {
-            ((model_mesh -> vertices)[model_mesh -> vertices_count]).tangent[j] = tangent[j];
-        }
+    return add_model_texture(texture.texture_path, content_hash, type, texture_params, loader) -> id;
+}
+
+static void get_material_textures(Material material, Texture* textures) {
+    textures[BASE_COLOR_TEXTURE] = material.pbr_metallic_roughness.base_color_texture;
+    textures[METALLIC_ROUGHNESS_TEXTURE] = material.pbr_metallic_roughness.metallic_roughness_texture;
+    textures[NORMAL_TEXTURE] = material.normal_texture.texture;
+    textures[OCCLUSION_TEXTURE] = material.occlusion_texture.texture;
+    textures[EMISSIVE_TEXTURE] = material.emissive_texture;
+    return;
+}
 
-        float* tex_coords = get_element_as_float(mesh.texture_coords, i);
-        for (unsigned int j = 0; j < elements_count[mesh.texture_coords.data_type] && (tex_coords != NULL); ++j) {
-            ((model_mesh -> vertices)[model_mesh -> vertices_count]).tex_coords[j] = tex_coords[j];
+// Start decoding every texture of the scene, so the decodes overlap the mesh conversion
+void queue_scene_textures(ModelLoader* loader) {
+    for (unsigned int i = 0; i < loader -> scene.materials_count; ++i) {
+        Texture textures[TEXTURE_TYPES_COUNT];
+        get_material_textures(loader -> scene.materials[i], textures);
+        for (unsigned int type = 0; type < TEXTURE_TYPES_COUNT; ++type) {
+            if (textures[type].texture_path != NULL) process_texture(textures[type], type, loader);
         }
     }
+    return;
+}
+
+// Content hashes of the encoded files, so byte-identical textures under different names are decoded once
+static void hash_texture_source(HashMap* content_hashes, const char* path) {
+    unsigned long long int path_hash = fnv1a_hash(path, strlen(path), FNV1A_OFFSET_BASIS);
+    unsigned long long int content_hash = 0;
+    if (!hash_map_get(content_hashes, path_hash, &content_hash)) hash_map_put(content_hashes, path_hash, hash_file(path));
+    return;
+}
+
+// NOTE: the textures must have been queued by queue_scene_textures
+static void add_material_binding(ModelMesh* model_mesh, Texture texture, TextureType type, Model* model) {
+    if (texture.texture_path == NULL) return;
+    ModelTexture* loaded_texture = find_loaded_texture(texture.texture_path, type, get_texture_params(texture), model);
+    if (loaded_texture == NULL) return;
+    model_mesh -> bindings[(model_mesh -> bindings_count)++] = (MaterialBinding) { .unit = type, .texture_id = loaded_texture -> id };
+    return;
+}
+
+static unsigned int count_mesh_indices(Mesh mesh) {
+    unsigned int indices_count = 0;
+    for (unsigned int i = 0; i < mesh.faces_count; ++i) {
+        indices_count += topology_size[mesh.faces[i].topology];
+    }
+    return indices_count;
+}
 
+// NOTE: touches no GL state nor shared data, so it can run on any thread
+ModelMesh* convert_mesh(Mesh mesh) {
+    ModelMesh* model_mesh = (ModelMesh*) calloc(1, sizeof(ModelMesh));
+    model_mesh -> vertices_count = mesh.vertices.arr.count;
+    model_mesh -> vertices = (Vertex*) calloc(model_mesh -> vertices_count, sizeof(Vertex));
+
+    // Every attribute must provide one element per vertex, a missing one is left zeroed
+    unpack_attribute(mesh.vertices, FALSE, model_mesh -> vertices, offsetof(Vertex, position), 3);
+    if (mesh.normals.arr.count == model_mesh -> vertices_count) unpack_attribute(mesh.normals, FALSE, model_mesh -> vertices, offsetof(Vertex, normal), 3);
+    if (mesh.tangents.arr.count == model_mesh -> vertices_count) unpack_attribute(mesh.tangents, FALSE, model_mesh -> vertices, offsetof(Vertex, tangent), 4);
+    if (mesh.texture_coords.arr.count == model_mesh -> vertices_count) unpack_attribute(mesh.texture_coords, TRUE, model_mesh -> vertices, offsetof(Vertex, tex_coords), 2);
+
+    model_mesh -> indices_count = count_mesh_indices(mesh);
+    model_mesh -> indices = (unsigned int*) calloc(model_mesh -> indices_count, sizeof(unsigned int));
+    unsigned int* indices = model_mesh -> indices;
     for (unsigned int i = 0; i < mesh.faces_count; ++i) {
-        Face face = mesh.faces[i];
-        for (unsigned int j = 0; j < topology_size[face.topology]; ++j, ++(model_mesh -> indices_count)) {
-            model_mesh -> indices = (unsigned int*) realloc(model_mesh -> indices, sizeof(unsigned int) * (model_mesh -> indices_count + 1));
-            (model_mesh -> indices)[model_mesh -> indices_count] = face.indices[j];
+        memcpy(indices, mesh.faces[i].indices, topology_size[mesh.faces[i].topology] * sizeof(unsigned int));
+        indices += topology_size[mesh.faces[i].topology];
+    }
+
+    return model_mesh;
+}
+
+// The features are the bound texture units, plus the alpha test of masked materials
+void process_material(ModelMesh* model_mesh, Material material, Model* model) {
+    add_material_binding(model_mesh, material.pbr_metallic_roughness.base_color_texture, BASE_COLOR_TEXTURE, model);
+    add_material_binding(model_mesh, material.pbr_metallic_roughness.metallic_roughness_texture, METALLIC_ROUGHNESS_TEXTURE, model);
+    add_material_binding(model_mesh, material.normal_texture.texture, NORMAL_TEXTURE, model);
+    add_material_binding(model_mesh, material.occlusion_texture.texture, OCCLUSION_TEXTURE, model);
+    add_material_binding(model_mesh, material.emissive_texture, EMISSIVE_TEXTURE, model);
+
+    for (unsigned int i = 0; i < model_mesh -> bindings_count; ++i) model_mesh -> features |= 1 << model_mesh -> bindings[i].unit;
+    if (material.alpha_mode != NULL && !strcmp(material.alpha_mode, "MASK")) {
+        model_mesh -> features |= FEATURE_ALPHA_MASK;
+        model_mesh -> alpha_cutoff = material.alpha_cutoff;
+    }
+
+    return;
+}
+
+static void convert_mesh_job(void* args) {
+    PROFILE_FUNCTION();
+    MeshJob* job = (MeshJob*) args;
+    job -> result = convert_mesh(job -> mesh);
+    __atomic_store_n(&(job -> is_converted), TRUE, __ATOMIC_RELEASE);
+    return;
+}
+
+// Decode the glTF file, then spread the conversion of its meshes over the worker threads
+static void parse_model_job(void* args) {
+    PROFILE_FUNCTION();
+    ModelLoader* loader = (ModelLoader*) args;
+
+    // The cache holds the content hashes, so a hit reads no image at all
+    if ((loader -> cache = open_mesh_cache(loader -> path, sizeof(Vertex))) != NULL) {
+        loader -> parse_time = glfwGetTime() - loader -> start_time;
+        __atomic_store_n(&(loader -> state), MODEL_STREAMING, __ATOMIC_RELEASE);
+        return;
+    }
+
+    loader -> scene = decode_gltf(loader -> path);
+    loader -> parse_time = glfwGetTime() - loader -> start_time;
+
+    if (loader -> scene.meshes == NULL) {
+        error_info("error while decoding the model.\n");
+        __atomic_store_n(&(loader -> state), MODEL_FAILED, __ATOMIC_RELEASE);
+        return;
+    }
+
+    loader -> mesh_jobs = (MeshJob*) calloc(loader -> scene.meshes_count, sizeof(MeshJob));
+    for (unsigned int i = 0; i < loader -> scene.meshes_count; ++i) {
+        loader -> mesh_jobs[i].mesh = loader -> scene.meshes[i];
+        submit_group_job(get_worker_pool(), &(loader -> jobs), convert_mesh_job, loader -> mesh_jobs + i);
+    }
+
+    // Hashed while the other workers convert the meshes
+    for (unsigned int i = 0; i < loader -> scene.materials_count; ++i) {
+        Texture textures[TEXTURE_TYPES_COUNT];
+        get_material_textures(loader -> scene.materials[i], textures);
+        for (unsigned int type = 0; type < TEXTURE_TYPES_COUNT; ++type) {
+            if (textures[type].texture_path != NULL) hash_texture_source(&(loader -> content_hashes), textures[type].texture_path);
         }
     }
 
-    Material material = scene.materials[mesh.material_index];
-    if (material.pbr_metallic_roughness.base_color_texture.texture_path != NULL) append_element(&(model_mesh -> textures), process_texture(material.pbr_metallic_roughness.base_color_texture, "base_color_texture", loaded_textures_arr));
-    if (material.pbr_metallic_roughness.metallic_roughness_texture.texture_path != NULL) append_element(&(model_mesh -> textures), process_texture(material.pbr_metallic_roughness.metallic_roughness_texture, "metallic_roughness_texture", loaded_textures_arr));
-    if (material.normal_texture.texture.texture_path != NULL) append_element(&(model_mesh -> textures), process_texture(material.normal_texture.texture, "normal_texture", loaded_textures_arr));
-    if (material.occlusion_texture.texture.texture_path != NULL) append_element(&(model_mesh -> textures), process_texture(material.occlusion_texture.texture, "occlusion_texture", loaded_textures_arr));
-    if (material.emissive_texture.texture_path != NULL) append_element(&(model_mesh -> textures), process_texture(material.emissive_texture, "emissive_texture", loaded_textures_arr));
+    __atomic_store_n(&(loader -> state), MODEL_STREAMING, __ATOMIC_RELEASE);
 
-    model_mesh -> VAO = (unsigned int*) calloc(1, sizeof(unsigned int));
-    model_mesh -> VBO = (unsigned int*) calloc(1, sizeof(unsigned int));
-    model_mesh -> EBO = (unsigned int*) calloc(1, sizeof(unsigned int));
+    return;
+}
 
-    setup_mesh(model_mesh);
+// Every node referencing a scene mesh draws the same range of the model buffers
+static ModelMesh* init_model_mesh(MeshJob* job, unsigned int mesh_index, Scene scene, Model* model) {
+    ModelMesh* model_mesh = (ModelMesh*) calloc(1, sizeof(ModelMesh));
+    model_mesh -> mesh_index = mesh_index;
+    model_mesh -> base_vertex = job -> base_vertex;
+    model_mesh -> first_index = job -> first_index;
+    model_mesh -> vertices_count = job -> vertices_count;
+    model_mesh -> indices_count = job -> indices_count;
+    process_material(model_mesh, scene.materials[job -> mesh.material_index], model);
+
+    // The normal map is sampled in tangent space, a mesh without tangents is lit with its vertex normals
+    if (job -> mesh.tangents.arr.count != job -> vertices_count) model_mesh -> features &= ~FEATURE_NORMAL_MAP;
 
     return model_mesh;
 }
 
-void process_node(Array* meshes, Scene scene, Node node, Array* loaded_textures_arr, Matrix parent_mat) {
-    Matrix transformation_mat = cast_mat(node.transformation_matrix, 4, 4, FALSE);
-    DOT_PRODUCT_MATRIX(&transformation_mat, parent_mat, transformation_mat);
+void process_node(Array* meshes, Scene scene, Node node, Model* model, Mat4 parent_mat, MeshJob* mesh_jobs) {
+    Mat4 transformation_mat = mat4_mul(parent_mat, mat4_from_array(node.transformation_matrix, FALSE));
 
     for (unsigned int i = 0; i < node.meshes_indices.count; ++i) {
         unsigned int mesh_index = *GET_ELEMENT(unsigned int*, node.meshes_indices, i);
-        Mesh mesh = scene.meshes[mesh_index];
-        ModelMesh* model_mesh = process_mesh(mesh, scene, loaded_textures_arr);
+        ModelMesh* model_mesh = init_model_mesh(mesh_jobs + mesh_index, mesh_index, scene, model);
         model_mesh -> transformation_matrix = transformation_mat;
         append_element(meshes, model_mesh);
     }
 
     for (unsigned int i = 0; i < node.children_count; ++i) {
-        process_node(meshes, scene, node.childrens[i], loaded_textures_arr, transformation_mat);
+        process_node(meshes, scene, node.childrens[i], model, transformation_mat, mesh_jobs);
     }
 
     return;
 }
 
-Model* load_model(char* path) {
-    Scene scene = decode_gltf(path);
+static int compare_mesh_features(const void* a, const void* b) {
+    const ModelMesh* mesh_a = *(ModelMesh* const*) a;
+    const ModelMesh* mesh_b = *(ModelMesh* const*) b;
+    if (mesh_a -> features != mesh_b -> features) return mesh_a -> features < mesh_b -> features ? -1 : 1;
+    return (mesh_a -> first_index > mesh_b -> first_index) - (mesh_a -> first_index < mesh_b -> first_index);
+}
 
-    if (scene.meshes == NULL) {
-        error_info("error while decoding the model.\n");
-        return NULL;
-    }
+// Groups the meshes drawn by the same shader variant, ties keep the buffer order
+static void sort_model_meshes(Model* model) {
+    qsort(model -> meshes.data, model -> meshes.count, sizeof(void*), compare_mesh_features);
+    return;
+}
 
+// Once the scene is parsed: lay the meshes out, reserve the buffers, start the texture decodes and build the node meshes
+static void begin_streaming(ModelLoader* loader) {
+    Scene scene = loader -> scene;
     Model* model = (Model*) calloc(1, sizeof(Model));
-    Array loaded_textures_arr = init_arr();
+    model -> directory = get_directory(loader -> path);
+    model -> meshes = init_arr();
+    model -> textures = init_arr();
+
+    for (unsigned int i = 0; i < scene.meshes_count; ++i) {
+        MeshJob* job = loader -> mesh_jobs + i;
+        job -> vertices_count = job -> mesh.vertices.arr.count;
+        job -> indices_count = count_mesh_indices(job -> mesh);
+        job -> base_vertex = model -> vertices_count;
+        job -> first_index = model -> indices_count;
+        model -> vertices_count += job -> vertices_count;
+        model -> indices_count += job -> indices_count;
+    }
+
+    allocate_model_buffers(model, NULL, NULL);
+    loader -> model = model;
 
-    model -> directory = get_directory(path);
+    init_texture_queue(&(loader -> texture_queue));
+    queue_scene_textures(loader);
+    process_node(&(model -> meshes), scene, scene.root_node, model, mat4_identity(), loader -> mesh_jobs);
+    sort_model_meshes(model);
+
+    return;
+}
+
+// The mapped vertices and indices are handed straight to glBufferData, only the textures still stream in
+static void begin_streaming_from_cache(ModelLoader* loader) {
+    MeshCache* cache = loader -> cache;
+    Model* model = (Model*) calloc(1, sizeof(Model));
+    model -> directory = get_directory(loader -> path);
     model -> meshes = init_arr();
-    Matrix id_mat = create_identity_matrix(4);
-    process_node(&(model -> meshes), scene, scene.root_node, &loaded_textures_arr, id_mat);
-    DEALLOCATE_MATRICES(id_mat);
+    model -> textures = init_arr();
+    model -> vertices_count = cache -> header -> vertices_count;
+    model -> indices_count = cache -> header -> indices_count;
+
+    allocate_model_buffers(model, cache -> vertices, cache -> indices);
+
+    // The paths outlive the mapping, so the strings section is copied into the model
+    model -> texture_paths = (char*) calloc(cache -> header -> strings_size + 1, sizeof(char));
+    memcpy(model -> texture_paths, cache -> strings, cache -> header -> strings_size);
+
+    loader -> model = model;
+    init_texture_queue(&(loader -> texture_queue));
+    for (unsigned int i = 0; i < cache -> header -> textures_count; ++i) {
+        CachedTexture cached_texture = cache -> textures[i];
+        add_model_texture(model -> texture_paths + cached_texture.path_offset, cached_texture.content_hash, cached_texture.type, cached_texture.texture_params, loader);
+    }
+
+    for (unsigned int i = 0; i < cache -> header -> meshes_count; ++i) {
+        CachedMesh* cached_mesh = cache -> meshes + i;
+        ModelMesh* model_mesh = (ModelMesh*) calloc(1, sizeof(ModelMesh));
+        model_mesh -> transformation_matrix = cached_mesh -> transformation_matrix;
+        model_mesh -> base_vertex = cached_mesh -> base_vertex;
+        model_mesh -> first_index = cached_mesh -> first_index;
+        model_mesh -> vertices_count = cached_mesh -> vertices_count;
+        model_mesh -> indices_count = cached_mesh -> indices_count;
+        model_mesh -> mesh_index = cached_mesh -> mesh_index;
+        model_mesh -> features = cached_mesh -> features;
+        model_mesh -> alpha_cutoff = cached_mesh -> alpha_cutoff;
+        model_mesh -> is_resident = TRUE;
+        for (unsigned int j = 0; j < cached_mesh -> bindings_count; ++j) {
+            ModelTexture* model_texture = GET_ELEMENT(ModelTexture*, model -> textures, cached_mesh -> bindings[j].texture_index);
+            model_mesh -> bindings[(model_mesh -> bindings_count)++] = (MaterialBinding) { .unit = cached_mesh -> bindings[j].unit, .texture_id = model_texture -> id };
+        }
+        append_element(&(model -> meshes), model_mesh);
+    }
+
+    debug_info("model loaded from the mesh cache in %.2f ms\n", (glfwGetTime() - loader -> start_time) * 1000.0);
+
+    close_mesh_cache(cache);
+    loader -> cache = NULL;
+
+    return;
+}
+
+// Snapshot of the loaded model, written by a worker from the converted meshes
+typedef struct MeshCacheWrite {
+    ModelLoader* loader;
+    MeshCacheHeader header;
+    CachedMesh* meshes;
+    CachedTexture* textures;
+    char* strings;
+} MeshCacheWrite;
+
+static void write_mesh_cache_job(void* args) {
+    PROFILE_FUNCTION();
+    MeshCacheWrite* write = (MeshCacheWrite*) args;
+    ModelLoader* loader = write -> loader;
+
+    // Gather the converted meshes in their final layout, then release them
+    Vertex* vertices = (Vertex*) malloc(write -> header.vertices_count * sizeof(Vertex));
+    unsigned int* indices = (unsigned int*) malloc(write -> header.indices_count * sizeof(unsigned int));
+    for (unsigned int i = 0; i < loader -> scene.meshes_count; ++i) {
+        MeshJob* job = loader -> mesh_jobs + i;
+        memcpy(vertices + job -> base_vertex, job -> result -> vertices, job -> vertices_count * sizeof(Vertex));
+        memcpy(indices + job -> first_index, job -> result -> indices, job -> indices_count * sizeof(unsigned int));
+        deallocate_mesh(job -> result);
+        job -> result = NULL;
+    }
+
+    write_mesh_cache(loader -> path, write -> header, vertices, indices, write -> meshes, write -> textures, write -> strings);
+
+    free(vertices);
+    free(indices);
+    free(write -> meshes);
+    free(write -> textures);
+    free(write -> strings);
+    free(write);
+
+    return;
+}
+
+// The bindings are stored as indices in the textures section, since the GL names change at every run
+static void queue_mesh_cache_write(ModelLoader* loader) {
+    Model* model = loader -> model;
+    MeshCacheWrite* write = (MeshCacheWrite*) calloc(1, sizeof(MeshCacheWrite));
+    write -> loader = loader;
+    write -> header = (MeshCacheHeader) {
+        .vertex_size = sizeof(Vertex),
+        .vertices_count = model -> vertices_count,
+        .indices_count = model -> indices_count,
+        .meshes_count = model -> meshes.count,
+        .textures_count = model -> textures.count
+    };
+
+    write -> textures = (CachedTexture*) calloc(model -> textures.count, sizeof(CachedTexture));
+    for (unsigned int i = 0; i < model -> textures.count; ++i) {
+        write -> header.strings_size += strlen(GET_ELEMENT(ModelTexture*, model -> textures, i) -> path) + 1;
+    }
+
+    write -> strings = (char*) calloc(write -> header.strings_size + 1, sizeof(char));
+    for (unsigned int i = 0, offset = 0; i < model -> textures.count; ++i) {
+        ModelTexture* model_texture = GET_ELEMENT(ModelTexture*, model -> textures, i);
+        write -> textures[i] = (CachedTexture) { .content_hash = model_texture -> entry -> content_hash, .type = model_texture -> type, .texture_params = model_texture -> texture_params, .path_offset = offset };
+        strcpy(write -> strings + offset, model_texture -> path);
+        offset += strlen(model_texture -> path) + 1;
+    }
+
+    write -> meshes = (CachedMesh*) calloc(model -> meshes.count, sizeof(CachedMesh));
+    for (unsigned int i = 0; i < model -> meshes.count; ++i) {
+        ModelMesh* mesh = GET_ELEMENT(ModelMesh*, model -> meshes, i);
+        CachedMesh* cached_mesh = write -> meshes + i;
+        *cached_mesh = (CachedMesh) {
+            .transformation_matrix = mesh -> transformation_matrix,
+            .base_vertex = mesh -> base_vertex,
+            .first_index = mesh -> first_index,
+            .vertices_count = mesh -> vertices_count,
+            .indices_count = mesh -> indices_count,
+            .mesh_index = mesh -> mesh_index,
+            .features = mesh -> features,
+            .alpha_cutoff = mesh -> alpha_cutoff,
+            .bindings_count = mesh -> bindings_count
+        };
+
+        for (unsigned int j = 0; j < mesh -> bindings_count; ++j) {
+            unsigned int texture_index = 0;
+            while (texture_index < model -> textures.count && GET_ELEMENT(ModelTexture*, model -> textures, texture_index) -> id != mesh -> bindings[j].texture_id) texture_index++;
+
+            // A binding to a texture the model no longer holds cannot be stored, the model is parsed again next time
+            if (texture_index == model -> textures.count) {
+                error_info("mesh %u binds a texture missing from the model, the mesh cache is not written\n", i);
+                free(write -> meshes);
+                free(write -> textures);
+                free(write -> strings);
+                free(write);
+                return;
+            }
+
+            cached_mesh -> bindings[j] = (CachedBinding) { .unit = mesh -> bindings[j].unit, .texture_index = texture_index };
+        }
+    }
+
+    submit_group_job(get_worker_pool(), &(loader -> jobs), write_mesh_cache_job, write);
+
+    return;
+}
+
+ModelLoader* load_model_async(char* path) {
+    ModelLoader* loader = (ModelLoader*) calloc(1, sizeof(ModelLoader));
+    loader -> path = path;
+    loader -> state = MODEL_PARSING;
+    loader -> start_time = glfwGetTime();
+    submit_group_job(get_worker_pool(), &(loader -> jobs), parse_model_job, loader);
+    return loader;
+}
+
+// Called on the context thread, it uploads the meshes and the textures completed since the last call without blocking.
+// The model can be drawn as soon as the state is MODEL_STREAMING, its meshes appear as they become resident.
+ModelState poll_model(ModelLoader* loader) {
+    PROFILE_FUNCTION();
+    ModelState state = __atomic_load_n(&(loader -> state), __ATOMIC_ACQUIRE);
+    if (state != MODEL_STREAMING) return state;
+
+    if (loader -> model == NULL) {
+        if (loader -> cache != NULL) begin_streaming_from_cache(loader);
+        else begin_streaming(loader);
+    }
+    Model* model = loader -> model;
+
+    for (unsigned int i = 0; i < loader -> scene.meshes_count; ++i) {
+        MeshJob* job = loader -> mesh_jobs + i;
+        if (job -> is_uploaded || !__atomic_load_n(&(job -> is_converted), __ATOMIC_ACQUIRE)) continue;
+
+        // The converted meshes are kept for the mesh cache, written once the model is complete
+        upload_mesh(model, job);
+        job -> is_uploaded = TRUE;
+        (loader -> uploaded_meshes)++;
+
+        for (unsigned int j = 0; j < model -> meshes.count; ++j) {
+            ModelMesh* mesh = GET_ELEMENT(ModelMesh*, model -> meshes, j);
+            if (mesh -> mesh_index == i) mesh -> is_resident = TRUE;
+        }
+    }
 
-    debug_info("model successfully loaded\n");
+    drain_texture_queue(&(loader -> texture_queue), FALSE);
+    if (loader -> uploaded_meshes < loader -> scene.meshes_count || loader -> texture_queue.pending_jobs) return MODEL_STREAMING;
+
+    if (GLAD_GL_ARB_multi_draw_indirect) setup_model_indirect(model);
+    deallocate_texture_queue(&(loader -> texture_queue));
+    if (loader -> mesh_jobs != NULL) queue_mesh_cache_write(loader);
+    print_texture_registry_stats();
+
+    debug_info("model successfully loaded: %u vertices, %u triangles\n", model -> vertices_count, model -> indices_count / 3);
+    debug_info("load time: %.2f ms (parse %.2f ms), peak RSS %.1f MB\n", (glfwGetTime() - loader -> start_time) * 1000.0, loader -> parse_time * 1000.0, get_peak_rss());
+
+    loader -> state = MODEL_READY;
+
+    return MODEL_READY;
+}
+
+// Waits for the jobs still in flight and frees the loader, returns the model only if it completed loading
+Model* release_model_loader(ModelLoader* loader) {
+    wait_group(get_worker_pool(), &(loader -> jobs));
+
+    // A model still streaming is discarded, together with its texture queue
+    Model* model = loader -> model;
+    if (loader -> state == MODEL_STREAMING && model != NULL) {
+        deallocate_texture_queue(&(loader -> texture_queue));
+        deallocate_model(model);
+        model = NULL;
+    }
+
+    for (unsigned int i = 0; loader -> mesh_jobs != NULL && i < loader -> scene.meshes_count; ++i) {
+        if (loader -> mesh_jobs[i].result != NULL) deallocate_mesh(loader -> mesh_jobs[i].result);
+    }
+    free(loader -> mesh_jobs);
+    close_mesh_cache(loader -> cache);
+    deallocate_hash_map(&(loader -> content_hashes));
+    free(loader);
 
     return model;
 }
 
+// Builds the texture caches of every material of the model, with the types the loader will bind them as.
+// compress must match the --compress-textures of the runs that will load the model. Returns the number of textures
+unsigned int warm_model_textures(char* path, bool compress) {
+    Scene scene = decode_gltf(path);
+    if (scene.meshes == NULL) {
+        error_info("error while decoding the model '%s'\n", path);
+        return 0;
+    }
+
+    // Each path and type is built once, as the loader would share it
+    HashMap queued = {0};
+    unsigned int textures_count = 0;
+    for (unsigned int i = 0; i < scene.materials_count; ++i) {
+        Texture textures[TEXTURE_TYPES_COUNT];
+        get_material_textures(scene.materials[i], textures);
+        for (unsigned int type = 0; type < TEXTURE_TYPES_COUNT; ++type) {
+            if (textures[type].texture_path == NULL) continue;
+            unsigned long long int key = fnv1a_hash(textures[type].texture_path, strlen(textures[type].texture_path), FNV1A_OFFSET_BASIS + type);
+            unsigned long long int value = 0;
+            if (hash_map_get(&queued, key, &value)) continue;
+            hash_map_put(&queued, key, 1);
+            queue_warm_texture(textures[type].texture_path, type, compress);
+            textures_count++;
+        }
+    }
+
+    wait_jobs(get_worker_pool());
+    deallocate_hash_map(&queued);
+    debug_info("texture cache up to date for %u textures of '%s' (%s)\n", textures_count, path, compress ? "compressed" : "uncompressed");
+
+    return textures_count;
+}
+
+// Blocking variant of load_model_async
+Model* load_model(char* path) {
+    PROFILE_FUNCTION();
+    ModelLoader* loader = load_model_async(path);
+    wait_group(get_worker_pool(), &(loader -> jobs));
+
+    if (poll_model(loader) == MODEL_STREAMING) {
+        drain_texture_queue(&(loader -> texture_queue), TRUE);
+        poll_model(loader);
+    }
+
+    return release_model_loader(loader);
+}
+
 #endif //_MODEL_H_
@@ -3,7 +3,31 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "./utils.h"
 
+// How the pages of a mapped file are going to be read, passed on to madvise
+typedef enum FileAccess { FILE_ACCESS_DEFAULT, FILE_ACCESS_SEQUENTIAL, FILE_ACCESS_RANDOM, FILE_ACCESS_PREFETCH } FileAccess;
+
+// Read-only view of a whole file, the data is NOT NUL terminated, always use the size.
+// NOTE: an empty file gives a valid view with NULL data
+typedef struct FileView {
+    const unsigned char* data;
+    size_t size;
+} FileView;
+
+/* DECLARATIONS */
+
+char* read_file(const char* file_path);
+bool map_file(const char* file_path, FileAccess access, FileView* view);
+void unmap_file(FileView* view);
+
+/* ----------------------------------------------- */
+
+// Returns a NUL terminated copy of the file, to be freed by the caller
 char* read_file(const char* file_path) {
     FILE* file = fopen(file_path, "rb");
 
@@ -19,7 +43,7 @@ char* read_file(const char* file_path) {
     fseek(file, 0, SEEK_SET);
 
     // Set the data buffer
-    char* data = (char*) calloc(length, 1);
+    char* data = (char*) calloc(length + 1, 1);
     length = fread(data, 1, length, file);
 
     // Check for errors
@@ -27,6 +51,7 @@ char* read_file(const char* file_path) {
     if ((err = ferror(file))) {
         // Free memory previously allocated
         free(data);
+        fclose(file);
         printf("READ_FILE:ERROR: the read operation terminated with the following error code: %d\n", err);
         return NULL;
     }
@@ -40,4 +65,42 @@ char* read_file(const char* file_path) {
     return data;
 }
 
+// Maps the file instead of copying it, the pages are only read from disk (or the page cache) when touched
+bool map_file(const char* file_path, FileAccess access, FileView* view) {
+    *view = (FileView) {0};
+
+    int fd = open(file_path, O_RDONLY);
+    if (fd == -1) return FALSE;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat)) {
+        close(fd);
+        return FALSE;
+    }
+
+    // mmap rejects empty mappings
+    if (file_stat.st_size == 0) {
+        close(fd);
+        return TRUE;
+    }
+
+    void* data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return FALSE;
+
+    const int advices[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED };
+    if (access != FILE_ACCESS_DEFAULT) madvise(data, file_stat.st_size, advices[access]);
+
+    view -> data = (const unsigned char*) data;
+    view -> size = file_stat.st_size;
+
+    return TRUE;
+}
+
+void unmap_file(FileView* view) {
+    if (view -> data != NULL) munmap((void*) (view -> data), view -> size);
+    *view = (FileView) {0};
+    return;
+}
+
 #endif // _PARSER_H_
@@ -0,0 +1,163 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "./utils.h"
+
+// CPU scopes recorded in a ring per thread, dumped as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+// The markers are always compiled in, while the profiler is disabled a scope costs a load and a branch on each end
+#define PROFILER_RING_SIZE 16384
+#define PROFILER_MAX_THREADS 64
+#define PROFILE_TRACE_PATH "./profile.json"
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// Times the rest of the enclosing block, the event is written when the block is left
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__) __attribute__((cleanup(end_profile_scope))) = begin_profile_scope(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+
+typedef struct ProfileEvent {
+    const char* name;
+    unsigned long long int begin;
+    unsigned long long int end;
+} ProfileEvent;
+
+// Only the owner thread writes, the head is published with release so the dump sees whole events
+typedef struct ProfileRing {
+    ProfileEvent events[PROFILER_RING_SIZE];
+    unsigned long long int head;
+    unsigned int thread_id;
+} ProfileRing;
+
+// The begin timestamp is 0 when the scope started with the profiler disabled
+typedef struct ProfileScope {
+    const char* name;
+    unsigned long long int begin;
+} ProfileScope;
+
+/* DECLARATIONS */
+
+void enable_profiler(void);
+bool is_profiler_enabled(void);
+unsigned long long int get_profile_time(void);
+ProfileScope begin_profile_scope(const char* name);
+void end_profile_scope(ProfileScope* scope);
+bool dump_profile_trace(const char* path);
+void deallocate_profiler(void);
+
+/* ----------------------------------------------- */
+
+static bool is_profiling = FALSE;
+static unsigned long long int profile_origin = 0;
+static ProfileRing* profile_rings[PROFILER_MAX_THREADS] = {0};
+static unsigned int profile_rings_count = 0;
+static _Thread_local ProfileRing* profile_ring = NULL;
+
+// NOTE: call it before starting any thread that records, the flag is not synchronized
+void enable_profiler(void) {
+    profile_origin = get_profile_time();
+    is_profiling = TRUE;
+    debug_info("profiling enabled, F12 or closing the window writes '%s'\n", PROFILE_TRACE_PATH);
+    return;
+}
+
+bool is_profiler_enabled(void) {
+    return is_profiling;
+}
+
+// Nanoseconds, CLOCK_MONOTONIC is read through the vDSO without a syscall
+unsigned long long int get_profile_time(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (unsigned long long int) time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+// The ring of a thread is allocated with its first event, the threads past PROFILER_MAX_THREADS record nothing
+static ProfileRing* get_profile_ring(void) {
+    if (profile_ring != NULL) return profile_ring;
+
+    unsigned int index = __atomic_fetch_add(&profile_rings_count, 1, __ATOMIC_RELAXED);
+    if (index >= PROFILER_MAX_THREADS) return NULL;
+
+    ProfileRing* ring = (ProfileRing*) calloc(1, sizeof(ProfileRing));
+    ring -> thread_id = (unsigned int) syscall(SYS_gettid);
+    __atomic_store_n(profile_rings + index, ring, __ATOMIC_RELEASE);
+    profile_ring = ring;
+
+    return ring;
+}
+
+ProfileScope begin_profile_scope(const char* name) {
+    return (ProfileScope) { .name = name, .begin = is_profiling ? get_profile_time() : 0 };
+}
+
+// Overwrites the oldest event once the ring is full
+void end_profile_scope(ProfileScope* scope) {
+    if (scope -> begin == 0) return;
+
+    ProfileRing* ring = get_profile_ring();
+    if (ring == NULL) return;
+
+    ProfileEvent* event = ring -> events + (ring -> head & (PROFILER_RING_SIZE - 1));
+    event -> name = scope -> name;
+    event -> begin = scope -> begin;
+    event -> end = get_profile_time();
+    __atomic_store_n(&(ring -> head), ring -> head + 1, __ATOMIC_RELEASE);
+
+    return;
+}
+
+// Writes the events of every ring as complete ("X") events, timestamps in microseconds from enable_profiler.
+// NOTE: the rings keep recording, an event overwritten while it is written may come out torn
+bool dump_profile_trace(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        error_info("failed to open the profile trace '%s'\n", path);
+        return FALSE;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    unsigned int events_count = 0;
+    unsigned int rings_count = __atomic_load_n(&profile_rings_count, __ATOMIC_RELAXED);
+    rings_count = rings_count < PROFILER_MAX_THREADS ? rings_count : PROFILER_MAX_THREADS;
+    for (unsigned int i = 0; i < rings_count; ++i) {
+        ProfileRing* ring = __atomic_load_n(profile_rings + i, __ATOMIC_ACQUIRE);
+        if (ring == NULL) continue;
+
+        unsigned long long int head = __atomic_load_n(&(ring -> head), __ATOMIC_ACQUIRE);
+        unsigned long long int first = head > PROFILER_RING_SIZE ? head - PROFILER_RING_SIZE : 0;
+        for (unsigned long long int j = first; j < head; ++j) {
+            ProfileEvent event = ring -> events[j & (PROFILER_RING_SIZE - 1)];
+            if (event.begin < profile_origin || event.end < event.begin) continue;
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", events_count ? ",\n" : "", event.name, (event.begin - profile_origin) / 1000.0, (event.end - event.begin) / 1000.0, ring -> thread_id);
+            events_count++;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    bool is_written = fclose(file) == 0;
+
+    if (is_written) debug_info("wrote %u profile events from %u threads to '%s'\n", events_count, rings_count, path);
+    else error_info("failed to write the profile trace '%s'\n", path);
+
+    return is_written;
+}
+
+// NOTE: no thread may record anymore
+void deallocate_profiler(void) {
+    unsigned int rings_count = profile_rings_count < PROFILER_MAX_THREADS ? profile_rings_count : PROFILER_MAX_THREADS;
+    for (unsigned int i = 0; i < rings_count; ++i) {
+        free(profile_rings[i]);
+        profile_rings[i] = NULL;
+    }
+    profile_rings_count = 0;
+    profile_ring = NULL;
+    is_profiling = FALSE;
+    return;
+}
+
+#endif //_PROFILER_H_
@@ -0,0 +1,150 @@
+#ifndef _PROGRAM_CACHE_H_
+#define _PROGRAM_CACHE_H_
+
+#include <sys/stat.h>
+#include "./utils.h"
+#include "./parser.h"
+#include "./extensions.h"
+
+// Linked programs saved with glGetProgramBinary, one file per set of shader sources.
+// The binaries only load on the driver that produced them, so the driver strings are part of the key.
+#define PROGRAM_CACHE_DIRECTORY "./cache/"
+#define PROGRAM_CACHE_MAGIC 0x4D475250 // "PRGM"
+#define PROGRAM_CACHE_VERSION 1
+
+typedef struct ProgramCacheHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long int key;
+    unsigned int binary_format;
+    unsigned int binary_size;
+} ProgramCacheHeader;
+
+/* DECLARATIONS */
+
+void disable_program_cache(void);
+bool is_program_cache_enabled(void);
+unsigned long long int get_program_key(const char** sources, const int* lengths, unsigned int sources_count);
+char* get_program_cache_path(unsigned long long int key);
+unsigned int load_program_binary(unsigned long long int key);
+void mark_program_retrievable(unsigned int program);
+bool save_program_binary(unsigned int program, unsigned long long int key);
+
+/* ----------------------------------------------- */
+
+static bool is_program_cache_disabled = FALSE;
+
+// Every program is compiled from source from now on, and no binary is written
+void disable_program_cache(void) {
+    is_program_cache_disabled = TRUE;
+    return;
+}
+
+bool is_program_cache_enabled(void) {
+    return GLAD_GL_ARB_get_program_binary && !is_program_cache_disabled;
+}
+
+// FNV-1a over the sources in order, then over the vendor, renderer and version strings of the driver
+unsigned long long int get_program_key(const char** sources, const int* lengths, unsigned int sources_count) {
+    unsigned long long int key = FNV1A_OFFSET_BASIS;
+    for (unsigned int i = 0; i < sources_count; ++i) key = fnv1a_hash(sources[i], lengths[i], key);
+
+    const GLenum driver_strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (unsigned int i = 0; i < sizeof(driver_strings) / sizeof(driver_strings[0]); ++i) {
+        const char* driver_string = (const char*) glGetString(driver_strings[i]);
+        if (driver_string != NULL) key = fnv1a_hash(driver_string, strlen(driver_string) + 1, key);
+    }
+
+    return key;
+}
+
+char* get_program_cache_path(unsigned long long int key) {
+    char* cache_path = (char*) calloc(sizeof(PROGRAM_CACHE_DIRECTORY) + 24, sizeof(char));
+    snprintf(cache_path, sizeof(PROGRAM_CACHE_DIRECTORY) + 24, PROGRAM_CACHE_DIRECTORY "%016llx.program", key);
+    return cache_path;
+}
+
+// Returns the linked program, or 0 when there is no binary or the driver rejected it (e.g. after an update with the same
+// version string). A rejected binary is removed, the caller compiles from source and saves a new one
+unsigned int load_program_binary(unsigned long long int key) {
+    if (!is_program_cache_enabled()) return 0;
+
+    FileView file = {0};
+    char* cache_path = get_program_cache_path(key);
+    bool is_mapped = map_file(cache_path, FILE_ACCESS_PREFETCH, &file);
+    if (!is_mapped) {
+        free(cache_path);
+        return 0;
+    }
+
+    ProgramCacheHeader* header = (ProgramCacheHeader*) file.data;
+    bool is_valid = file.size >= sizeof(ProgramCacheHeader) && header -> magic == PROGRAM_CACHE_MAGIC && header -> version == PROGRAM_CACHE_VERSION;
+    is_valid = is_valid && header -> key == key && header -> binary_size == file.size - sizeof(ProgramCacheHeader);
+
+    unsigned int program = 0;
+    if (is_valid) {
+        program = glCreateProgram();
+        glProgramBinary(program, header -> binary_format, file.data + sizeof(ProgramCacheHeader), header -> binary_size);
+
+        int status = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (!status) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    unmap_file(&file);
+
+    if (!program) {
+        debug_info("program binary '%s' was rejected, compiling from source\n", cache_path);
+        remove(cache_path);
+    }
+    free(cache_path);
+
+    return program;
+}
+
+// Must be called before linking, some drivers only keep the binary of programs that asked for it
+void mark_program_retrievable(unsigned int program) {
+    if (is_program_cache_enabled()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    return;
+}
+
+// Written under a temporary name and renamed, like the other caches
+bool save_program_binary(unsigned int program, unsigned long long int key) {
+    if (!is_program_cache_enabled()) return FALSE;
+
+    int binary_size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    if (binary_size <= 0) return FALSE;
+
+    ProgramCacheHeader* header = (ProgramCacheHeader*) calloc(1, sizeof(ProgramCacheHeader) + binary_size);
+    GLenum binary_format = 0;
+    glGetProgramBinary(program, binary_size, &binary_size, &binary_format, header + 1);
+    *header = (ProgramCacheHeader) { .magic = PROGRAM_CACHE_MAGIC, .version = PROGRAM_CACHE_VERSION, .key = key, .binary_format = binary_format, .binary_size = binary_size };
+
+    mkdir(PROGRAM_CACHE_DIRECTORY, 0755);
+    char* cache_path = get_program_cache_path(key);
+    char* temp_path = (char*) calloc(strlen(cache_path) + 5, sizeof(char));
+    sprintf(temp_path, "%s.tmp", cache_path);
+
+    FILE* file = fopen(temp_path, "wb");
+    bool is_written = file != NULL;
+    if (is_written) {
+        is_written = fwrite(header, 1, sizeof(ProgramCacheHeader) + binary_size, file) == sizeof(ProgramCacheHeader) + binary_size;
+        is_written = (fclose(file) == 0) && is_written;
+    }
+
+    if (is_written) is_written = rename(temp_path, cache_path) == 0;
+    else remove(temp_path);
+
+    if (!is_written) error_info("failed to write the program binary '%s'\n", cache_path);
+
+    free(temp_path);
+    free(cache_path);
+    free(header);
+
+    return is_written;
+}
+
+#endif //_PROGRAM_CACHE_H_
@@ -4,71 +4,194 @@
 #include "./transformation.h"
 #include "./camera.h"
 #include "./model.h"
+#include "./instancing.h"
+#include "./shader_watcher.h"
 #include "./input.h"
-
-void set_frustum(unsigned int shader, Camera camera) {
-    Matrix view = look_at(camera);
-    Matrix projection = perspective_matrix(get_scroll_position(), (float) WIDTH / (float) HEIGHT, 0.1f, 100.0f);
-    Matrix rotation_mat = create_identity_matrix(4);
-    rotation_x_matrix(-90.0f, 4, &rotation_mat);
-    Vector scale_vec = VEC(0.025f, 0.025f, 0.025f);
-    Matrix camera_matrix = create_identity_matrix(4);
-    DOT_PRODUCT_MATRIX(&camera_matrix, projection, view, rotation_mat);
-    scale_matrix(camera_matrix, scale_vec, &camera_matrix);
-    set_matrix(shader, "camera_matrix", camera_matrix.data, glUniformMatrix4fv);
-    DEALLOCATE_MATRICES(view, projection, camera_matrix);
+#include "./alloc_counter.h"
+#include "./profiler.h"
+
+#ifdef _INSTANCING_BENCHMARK_
+    #define BENCHMARK_INSTANCES 10000
+    #define BENCHMARK_SPACING 150.0f
+    #define BENCHMARK_REPORT_FRAMES 300
+#endif
+
+// The camera matrix reaches each shader variant the first time it is used in the frame
+void set_frustum(ShaderVariants* shaders, Camera camera) {
+    PROFILE_FUNCTION();
+    Mat4 view = mat4_look_at(camera.camera_pos, camera.camera_front, camera.camera_up);
+    Mat4 projection = mat4_perspective(get_scroll_position(), (float) WIDTH / (float) HEIGHT, 0.1f, 100.0f);
+    Mat4 rotation_mat = mat4_rotation_x(-90.0f);
+    Mat4 camera_matrix = mat4_mul(mat4_mul(projection, view), rotation_mat);
+    camera_matrix = mat4_scale(camera_matrix, vec3(0.025f, 0.025f, 0.025f));
+    begin_shader_frame(shaders, camera_matrix, camera.camera_pos);
     return;
 }
 
-void render(GLFWwindow* window, unsigned int vertex_shader) {
+// Draws until the window is closed, or for frames_limit frames when it is not 0.
+// Returns TRUE when the model became resident, so a run with a limit can tell that its steady state was checked
+bool render(GLFWwindow* window, ShaderVariants* shaders, unsigned long long int frames_limit) {
     // Set the camera parameters
-    Vector camera_pos = VEC(0.0f, 0.0f,  3.0f);
-    Vector camera_front = VEC(0.0f, 0.0f, -1.0f);
-    Vector camera_up = VEC(0.0f, 1.0f,  0.0f);
-    Camera camera = init_camera(camera_pos, camera_front, camera_up, 2.5f);
-    Model* object_model = load_model("/home/Emanuele/Informatica/OpenGL/assets/grindstone/");
-    if (object_model == NULL) return;
+    Camera camera = init_camera(vec3(0.0f, 0.0f,  3.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 1.0f,  0.0f), 2.5f);
+    // The model streams in while the frames are drawn, its meshes appear as they become resident
+    ModelLoader* model_loader = load_model_async("/home/Emanuele/Informatica/OpenGL/assets/grindstone/");
+    double render_start = glfwGetTime();
+    bool is_model_ready = FALSE;
+    unsigned long long int ready_frame = 0;
+    unsigned long long int shader_changes = 0;
+
+    // Submit the whole model with multi-draw indirect when the driver supports it and the INDIRECT variant builds
+    bool use_indirect = GLAD_GL_ARB_multi_draw_indirect && wait_shader_variant(shaders, FEATURE_INDIRECT) -> state == VARIANT_READY;
+    debug_info("Drawing with %s\n", use_indirect ? "glMultiDrawElementsIndirect" : "glDrawElementsBaseVertex");
+
+    // The variants of the steady state are built while the meshes stream in
+    bool are_shaders_prepared = FALSE;
+#ifdef _INSTANCING_BENCHMARK_
+    unsigned int pipeline_features = FEATURE_INSTANCED;
+#else
+    unsigned int pipeline_features = use_indirect ? FEATURE_INDIRECT : 0;
+#endif
+
+    shaders -> frame_uniforms.light_color = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+
+    // Saving a shader rebuilds the variants while the frames keep going, the model stays loaded
+    ShaderWatcher shader_watcher;
+    char* shader_directory = get_directory(shaders -> vertex_path);
+    init_shader_watcher(&shader_watcher, shader_directory);
+    free(shader_directory);
+
+#ifdef _INSTANCING_BENCHMARK_
+    // Benchmark scene: copies of the model laid out on a square grid centered on the origin
+    ModelInstances instances = {0};
+    Mat4* instance_transforms = (Mat4*) calloc(BENCHMARK_INSTANCES, sizeof(Mat4));
+    unsigned int side = (unsigned int) ceilf(sqrtf((float) BENCHMARK_INSTANCES));
+    for (unsigned int i = 0; i < BENCHMARK_INSTANCES; ++i) {
+        Vec3 offset = vec3(((float) (i % side) - side / 2.0f) * BENCHMARK_SPACING, ((float) (i / side) - side / 2.0f) * BENCHMARK_SPACING, 0.0f);
+        instance_transforms[i] = mat4_translate(mat4_identity(), offset);
+    }
 
-	Vector light_color = alloc_vector(1.0f, 4);
-    set_vec(vertex_shader, "light_color", light_color.data, glUniform4fv);
-    DEALLOCATE_MATRICES(light_color);
+    debug_info("Benchmarking %u instances\n", BENCHMARK_INSTANCES);
+    double benchmark_start = glfwGetTime();
+#endif
 
     glEnable(GL_DEPTH_TEST); // configure global opengl state
 
-    while (!glfwWindowShouldClose(window)) {
+    // F12 writes the trace on release, so holding it down writes it once
+    bool is_dump_key_down = FALSE;
+
+    for (unsigned long long int frame = 0; !glfwWindowShouldClose(window) && (frames_limit == 0 || frame < frames_limit); ++frame) {
+        PROFILE_SCOPE("frame");
+        unsigned long long int frame_allocations = get_allocations_count();
+        unsigned long long int frame_gl_calls = gl_calls_count;
+
+        ModelState model_state = poll_model(model_loader);
+        if (model_state == MODEL_FAILED) break;
+        if (model_state == MODEL_READY && !is_model_ready) {
+            is_model_ready = TRUE;
+            ready_frame = frame;
+            debug_info("model resident after %llu frames\n", frame);
+        }
+        Model* object_model = model_loader -> model;
+        if (object_model != NULL && !are_shaders_prepared) {
+            prepare_model_shaders(shaders, object_model, pipeline_features);
+            are_shaders_prepared = TRUE;
+        }
+
+        if (poll_shader_watcher(&shader_watcher, shaders -> vertex_path, shaders -> fragment_path)) reload_shader_variants(shaders);
+
         // Update the camera speed
         update_camera_speed(&camera, FALSE);
-        update_camera_front(camera, get_mouse_position());
+        update_camera_front(&camera, get_mouse_position());
 
         // Handle user input
         processInput(window, &camera);
 
         // Clean the window before rendering anything
-        glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // also clear the depth buffer now!
-
+        GL_CALL(glClearColor(0.05f, 0.05f, 0.05f, 1.0f));
+        GL_CALL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)); // also clear the depth buffer now!
+
+#ifdef _INSTANCING_BENCHMARK_
+        // Submit the transforms of every copy and draw them with one instanced draw per mesh.
+        // The grid does not move, but the upload stays in the frame: it is the submission path being measured
+        if (instances.VAO == 0 && object_model != NULL) instances = init_model_instances(object_model, BENCHMARK_INSTANCES);
+        set_frustum(shaders, camera);
+        if (instances.VAO != 0) {
+            set_model_instances(&instances, instance_transforms, BENCHMARK_INSTANCES);
+            draw_model_instances(shaders, &instances);
+        }
+#else
         // Create the frustum (view, projection and model matrices)
-        set_frustum(vertex_shader, camera);
+        set_frustum(shaders, camera);
 
-        // Render the cubes
-        draw_model(vertex_shader, object_model, &camera);
+        // Render the cubes, the indirect commands are only built once every mesh is resident
+        if (object_model != NULL) {
+            if (use_indirect && is_model_ready) draw_model_indirect(shaders, object_model);
+            else draw_model(shaders, object_model);
+        }
+#endif
 
         // Swap buffers and poll IO events
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
+
+        if (is_profiler_enabled()) {
+            if (is_dump_key_down && !GET_PRESSED_KEY(window, GLFW_KEY_F12)) dump_profile_trace(PROFILE_TRACE_PATH);
+            is_dump_key_down = GET_PRESSED_KEY(window, GLFW_KEY_F12);
+        }
+
+        // Release the temporaries of this frame
+        frame_arena_reset();
+
+        if (frame == 0) debug_info("time to first frame: %.2f ms\n", (glfwGetTime() - render_start) * 1000.0);
+
+        // Streaming allocates, so the steady state starts once the model is resident.
+        // The variants finish on whatever frame the driver is done with them and building a program allocates too,
+        // so the warm-up starts over after each frame that started or finished a build.
+        // A hot reload counts as one build from the save to the swap, the frames in between are not checked either
+        if (shaders -> changes_count != shader_changes || shaders -> reloads_count) {
+            shader_changes = shaders -> changes_count;
+            ready_frame = frame;
+        }
+        if (is_model_ready) {
+            check_frame_allocations(frame - ready_frame, frame_allocations);
+            if (frame - ready_frame == ALLOC_WARM_UP_FRAMES) debug_info("GL calls per frame: %llu\n", gl_calls_count - frame_gl_calls);
+        }
+
+#ifdef _INSTANCING_BENCHMARK_
+        if ((frame + 1) % BENCHMARK_REPORT_FRAMES == 0) {
+            double benchmark_end = glfwGetTime();
+            debug_info("%u instances: %.3f ms per frame\n", BENCHMARK_INSTANCES, (benchmark_end - benchmark_start) * 1000.0 / BENCHMARK_REPORT_FRAMES);
+            benchmark_start = benchmark_end;
+        }
+#endif
     }
 
-    // Deallocate the camera
-    deallocate_camera(camera);
+    close_shader_watcher(&shader_watcher);
+
+    debug_info("frame arena high-water mark: %zu/%zu bytes\n", get_frame_arena() -> high_water_mark, get_frame_arena() -> capacity);
+
+#ifdef _INSTANCING_BENCHMARK_
+    deallocate_model_instances(&instances);
+    free(instance_transforms);
+#endif
 
     // Deallocate model
-    deallocate_model(object_model);
+    Model* object_model = release_model_loader(model_loader);
+    if (object_model != NULL) deallocate_model(object_model);
 
-    return;
+    return is_model_ready;
 }
 
-void terminate(unsigned int vertex_shader) {
-    glDeleteProgram(vertex_shader);
+void terminate(ShaderVariants* shaders) {
+    deallocate_shader_variants(shaders);
+    deallocate_texture_registry();
+    deallocate_worker_pool();
+    // The workers are gone, so the last trace is complete
+    if (is_profiler_enabled()) dump_profile_trace(PROFILE_TRACE_PATH);
+    deallocate_profiler();
     glfwTerminate();
     return;
 }
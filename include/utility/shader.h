@@ -0,0 +1,211 @@
+#ifndef _SHADER_H_
+#define _SHADER_H_
+
+#include <string.h>
+#include "./utils.h"
+#include "./texture.h"
+
+#define MAX_UNIFORM_NAME_LENGTH 64
+#define GL_CALL(call) (++gl_calls_count, (call))
+#define MESH_TRANSFORMS_UNIT TEXTURE_TYPES_COUNT
+
+typedef struct Uniform {
+    char name[MAX_UNIFORM_NAME_LENGTH];
+    int location;
+} Uniform;
+
+// Active uniforms of a linked program, queried once after linking
+typedef struct UniformTable {
+    unsigned int program;
+    Uniform* uniforms;
+    unsigned int count;
+} UniformTable;
+
+// Uniform handles used by the render loop, resolved once per program
+typedef struct ShaderProgram {
+    unsigned int id;
+    int camera_matrix;
+    int transform;
+    int cam_pos;
+    int light_color;
+    int alpha_cutoff;
+    int samplers[TEXTURE_TYPES_COUNT];
+    int mesh_transforms;
+} ShaderProgram;
+
+/* DECLARATIONS */
+
+void build_uniform_table(unsigned int program);
+void deallocate_uniform_table(unsigned int program);
+int get_uniform(unsigned int program, const char* name);
+ShaderProgram init_shader_program(unsigned int program);
+void use_program(unsigned int program);
+void set_uniform_int(int location, int value);
+void set_uniform_float(int location, float value);
+void set_uniform_vec3(int location, const float* value);
+void set_uniform_vec4(int location, const float* value);
+void set_uniform_mat4(int location, const float* value);
+void set_int(unsigned int shader, const char* obj_name, int obj_data, void (*uniform_value)(GLint, GLint));
+void set_vec(unsigned int shader, const char* obj_name, float* obj_data, void (*uniform_vec)(GLint, GLsizei, const GLfloat*));
+void set_float(unsigned int shader, const char* obj_name, float obj_data, void (*uniform_value)(GLint, GLfloat));
+void set_matrix(unsigned int shader, const char* obj_name, float* obj_data, void (*uniform_mat)(GLint, GLsizei, GLboolean, const GLfloat*));
+
+/* ----------------------------------------------- */
+
+// Number of GL calls issued through GL_CALL, sample it around a frame to get the per-frame count
+static unsigned long long int gl_calls_count = 0;
+static UniformTable* uniform_tables = NULL;
+static unsigned int uniform_tables_count = 0;
+static unsigned int current_program = 0;
+
+static UniformTable* find_uniform_table(unsigned int program) {
+    for (unsigned int i = 0; i < uniform_tables_count; ++i) {
+        if (uniform_tables[i].program == program) return uniform_tables + i;
+    }
+    return NULL;
+}
+
+void build_uniform_table(unsigned int program) {
+    deallocate_uniform_table(program);
+
+    int active_uniforms = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &active_uniforms);
+
+    UniformTable table = { .program = program, .count = 0 };
+    table.uniforms = (Uniform*) calloc(active_uniforms > 0 ? active_uniforms : 1, sizeof(Uniform));
+
+    for (int i = 0; i < active_uniforms; ++i) {
+        Uniform* uniform = table.uniforms + table.count;
+        int size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, i, MAX_UNIFORM_NAME_LENGTH, NULL, &size, &type, uniform -> name);
+
+        // Arrays are reported as "name[0]", store them by their plain name
+        char* subscript = strstr(uniform -> name, "[0]");
+        if (subscript != NULL) *subscript = '\0';
+
+        // Uniforms inside uniform blocks have no location
+        uniform -> location = glGetUniformLocation(program, uniform -> name);
+        if (uniform -> location != -1) table.count++;
+    }
+
+    uniform_tables = (UniformTable*) realloc(uniform_tables, (uniform_tables_count + 1) * sizeof(UniformTable));
+    uniform_tables[uniform_tables_count++] = table;
+
+    return;
+}
+
+void deallocate_uniform_table(unsigned int program) {
+    UniformTable* table = find_uniform_table(program);
+    if (table == NULL) return;
+
+    free(table -> uniforms);
+    *table = uniform_tables[--uniform_tables_count];
+
+    if (current_program == program) current_program = 0;
+
+    return;
+}
+
+// Return the location of an active uniform, or -1 (ignored by glUniform*) when the program does not use it
+int get_uniform(unsigned int program, const char* name) {
+    UniformTable* table = find_uniform_table(program);
+    if (table == NULL) return -1;
+
+    for (unsigned int i = 0; i < table -> count; ++i) {
+        if (!strcmp(table -> uniforms[i].name, name)) return table -> uniforms[i].location;
+    }
+
+    return -1;
+}
+
+ShaderProgram init_shader_program(unsigned int program) {
+    ShaderProgram shader = {
+        .id = program,
+        .camera_matrix = get_uniform(program, "camera_matrix"),
+        .transform = get_uniform(program, "transform"),
+        .cam_pos = get_uniform(program, "cam_pos"),
+        .light_color = get_uniform(program, "light_color"),
+        .alpha_cutoff = get_uniform(program, "alpha_cutoff"),
+        .mesh_transforms = get_uniform(program, "mesh_transforms")
+    };
+
+    // Each sampler reads from the texture unit of its texture type, so the draw path only binds textures
+    use_program(program);
+    for (unsigned int i = 0; i < TEXTURE_TYPES_COUNT; ++i) {
+        char sampler_name[MAX_UNIFORM_NAME_LENGTH];
+        snprintf(sampler_name, sizeof(sampler_name), "%s0", texture_type_str[i]);
+        shader.samplers[i] = get_uniform(program, sampler_name);
+        set_uniform_int(shader.samplers[i], i);
+    }
+    set_uniform_int(shader.mesh_transforms, MESH_TRANSFORMS_UNIT);
+
+    return shader;
+}
+
+// Bind the program only if it is not already the current one
+void use_program(unsigned int program) {
+    if (current_program == program) return;
+    GL_CALL(glUseProgram(program));
+    current_program = program;
+    return;
+}
+
+// NOTE: the set_uniform_* functions act on the current program, see use_program
+
+void set_uniform_int(int location, int value) {
+    GL_CALL(glUniform1i(location, value));
+    return;
+}
+
+void set_uniform_float(int location, float value) {
+    GL_CALL(glUniform1f(location, value));
+    return;
+}
+
+void set_uniform_vec3(int location, const float* value) {
+    GL_CALL(glUniform3fv(location, 1, value));
+    return;
+}
+
+void set_uniform_vec4(int location, const float* value) {
+    GL_CALL(glUniform4fv(location, 1, value));
+    return;
+}
+
+// Matrices are stored in row-major order, so they are transposed on upload
+void set_uniform_mat4(int location, const float* value) {
+    GL_CALL(glUniformMatrix4fv(location, 1, GL_TRUE, value));
+    return;
+}
+
+/* NAME-BASED SETTERS */
+
+// Kept for compatibility: the location comes from the uniform table instead of glGetUniformLocation,
+// prefer resolving a handle once with get_uniform and using the set_uniform_* functions
+
+void set_int(unsigned int shader, const char* obj_name, int obj_data, void (*uniform_value)(GLint, GLint)) {
+    use_program(shader);
+    GL_CALL((*uniform_value)(get_uniform(shader, obj_name), obj_data));
+    return;
+}
+
+void set_vec(unsigned int shader, const char* obj_name, float* obj_data, void (*uniform_vec)(GLint, GLsizei, const GLfloat*)) {
+    use_program(shader);
+    GL_CALL((*uniform_vec)(get_uniform(shader, obj_name), 1, obj_data));
+    return;
+}
+
+void set_float(unsigned int shader, const char* obj_name, float obj_data, void (*uniform_value)(GLint, GLfloat)) {
+    use_program(shader);
+    GL_CALL((*uniform_value)(get_uniform(shader, obj_name), obj_data));
+    return;
+}
+
+void set_matrix(unsigned int shader, const char* obj_name, float* obj_data, void (*uniform_mat)(GLint, GLsizei, GLboolean, const GLfloat*)) {
+    use_program(shader);
+    GL_CALL((*uniform_mat)(get_uniform(shader, obj_name), 1, GL_TRUE, obj_data));
+    return;
+}
+
+#endif //_SHADER_H_
@@ -0,0 +1,264 @@
+#ifndef _SHADER_VARIANTS_H_
+#define _SHADER_VARIANTS_H_
+
+#include "./utils.h"
+#include "./types.h"
+#include "./matrix.h"
+#include "./shader.h"
+#include "./loader.h"
+#include "./profiler.h"
+
+// Specializations of one vertex and fragment shader pair, selected with #define flags inserted by the loader.
+// The texture flags match the texture types, so the features of a material are the units it binds.
+typedef enum ShaderFeature {
+    FEATURE_BASE_COLOR_MAP = 1 << BASE_COLOR_TEXTURE,
+    FEATURE_METALLIC_ROUGHNESS_MAP = 1 << METALLIC_ROUGHNESS_TEXTURE,
+    FEATURE_NORMAL_MAP = 1 << NORMAL_TEXTURE,
+    FEATURE_OCCLUSION_MAP = 1 << OCCLUSION_TEXTURE,
+    FEATURE_EMISSIVE_MAP = 1 << EMISSIVE_TEXTURE,
+    FEATURE_ALPHA_MASK = 1 << 5,
+    FEATURE_INDIRECT = 1 << 6,
+    FEATURE_INSTANCED = 1 << 7,
+    SHADER_FEATURES_COUNT = 8
+} ShaderFeature;
+
+// The draw path picks the pipeline features, the material features come from the meshes
+#define PIPELINE_FEATURES (FEATURE_INDIRECT | FEATURE_INSTANCED)
+
+const char* shader_feature_str[] = { "HAS_BASE_COLOR_MAP", "HAS_METALLIC_ROUGHNESS_MAP", "HAS_NORMAL_MAP", "HAS_OCCLUSION_MAP", "HAS_EMISSIVE_MAP", "ALPHA_MASK", "INDIRECT", "INSTANCED" };
+
+// Uniforms shared by every variant, uploaded to a program the first time it is used in a frame
+typedef struct FrameUniforms {
+    Mat4 camera_matrix;
+    Vec3 cam_pos;
+    Vec4 light_color;
+    unsigned long long int frame;
+} FrameUniforms;
+
+typedef enum VariantState { VARIANT_COMPILING, VARIANT_READY, VARIANT_FAILED } VariantState;
+
+// The program id is INT32_MAX until the variant is ready, and stays so when it failed to build so it is not retried every frame.
+// A reload builds next to the current program, which keeps drawing until the swap
+typedef struct ShaderVariant {
+    unsigned int features;
+    VariantState state;
+    ShaderBuild build;
+    ShaderBuild reload;
+    bool is_reloading;
+    ShaderProgram program;
+    unsigned long long int frame;
+} ShaderVariant;
+
+// The changes count goes up whenever a build starts, finishes or is swapped in, all of them allocate
+// (uniform tables, program cache paths), so the render loop can tell the frames that built shaders from its steady state
+typedef struct ShaderVariants {
+    char* vertex_path;
+    char* fragment_path;
+    Array variants;
+    FrameUniforms frame_uniforms;
+    unsigned int reloads_count;
+    unsigned long long int changes_count;
+} ShaderVariants;
+
+/* DECLARATIONS */
+
+bool init_shader_variants(ShaderVariants* shaders, const char* vertex_path, const char* fragment_path);
+ShaderVariant* get_shader_variant(ShaderVariants* shaders, unsigned int features);
+bool poll_shader_variant(ShaderVariants* shaders, ShaderVariant* variant);
+ShaderVariant* wait_shader_variant(ShaderVariants* shaders, unsigned int features);
+ShaderProgram* use_shader_variant(ShaderVariants* shaders, unsigned int features);
+void begin_shader_frame(ShaderVariants* shaders, Mat4 camera_matrix, Vec3 cam_pos);
+void reload_shader_variants(ShaderVariants* shaders);
+void deallocate_shader_variants(ShaderVariants* shaders);
+
+/* ----------------------------------------------- */
+
+// Waits for the variant without features, so a broken shader is reported at startup.
+// The indirect variant is started first, so both fallbacks are built by the driver in parallel
+bool init_shader_variants(ShaderVariants* shaders, const char* vertex_path, const char* fragment_path) {
+    *shaders = (ShaderVariants) { .variants = init_arr() };
+    shaders -> vertex_path = (char*) calloc(strlen(vertex_path) + 1, sizeof(char));
+    shaders -> fragment_path = (char*) calloc(strlen(fragment_path) + 1, sizeof(char));
+    strcpy(shaders -> vertex_path, vertex_path);
+    strcpy(shaders -> fragment_path, fragment_path);
+    shaders -> frame_uniforms = (FrameUniforms) { .camera_matrix = mat4_identity(), .light_color = vec4(1.0f, 1.0f, 1.0f, 1.0f), .frame = 1 };
+    if (GLAD_GL_ARB_multi_draw_indirect) get_shader_variant(shaders, FEATURE_INDIRECT);
+    bool is_ready = wait_shader_variant(shaders, 0) -> state == VARIANT_READY;
+    if (GLAD_GL_ARB_multi_draw_indirect) wait_shader_variant(shaders, FEATURE_INDIRECT);
+    return is_ready;
+}
+
+static void get_feature_defines(unsigned int features, char* defines, size_t size) {
+    defines[0] = '\0';
+    for (unsigned int i = 0; i < SHADER_FEATURES_COUNT; ++i) {
+        if (!(features & (1 << i))) continue;
+        size_t length = strlen(defines);
+        snprintf(defines + length, size - length, "#define %s\n", shader_feature_str[i]);
+    }
+    return;
+}
+
+// The build starts on the first request and every later one finds it in the list, use poll_shader_variant to know when it is ready
+ShaderVariant* get_shader_variant(ShaderVariants* shaders, unsigned int features) {
+    for (unsigned int i = 0; i < shaders -> variants.count; ++i) {
+        ShaderVariant* variant = GET_ELEMENT(ShaderVariant*, shaders -> variants, i);
+        if (variant -> features == features) return variant;
+    }
+
+    char defines[512];
+    get_feature_defines(features, defines, sizeof(defines));
+
+    ShaderVariant* variant = (ShaderVariant*) calloc(1, sizeof(ShaderVariant));
+    variant -> features = features;
+    variant -> program.id = INT32_MAX;
+    variant -> state = start_shader_build(&(variant -> build), shaders -> vertex_path, shaders -> fragment_path, defines) ? VARIANT_COMPILING : VARIANT_FAILED;
+    append_element(&(shaders -> variants), variant);
+    (shaders -> changes_count)++;
+
+    return variant;
+}
+
+// Blocks until the driver is done with the build
+static void finish_shader_variant(ShaderVariants* shaders, ShaderVariant* variant) {
+    PROFILE_FUNCTION();
+    unsigned int program = finish_shader_build(&(variant -> build));
+    if (program != INT32_MAX) {
+        variant -> program = init_shader_program(program);
+        variant -> state = VARIANT_READY;
+    } else variant -> state = VARIANT_FAILED;
+    (shaders -> changes_count)++;
+
+    // The latency runs from the start of the build to the poll that found it done
+    debug_info("shader variant 0x%02x %s after %.2f ms%s\n", variant -> features, variant -> state == VARIANT_READY ? "ready" : "FAILED", variant -> build.latency * 1000.0, variant -> build.is_binary ? " (binary)" : "");
+
+    return;
+}
+
+// Returns TRUE once the variant is ready, only blocks when the driver cannot report the completion of a build
+bool poll_shader_variant(ShaderVariants* shaders, ShaderVariant* variant) {
+    if (variant -> state == VARIANT_COMPILING && is_shader_build_done(&(variant -> build))) finish_shader_variant(shaders, variant);
+    return variant -> state == VARIANT_READY;
+}
+
+// For the fallback variants, something has to draw the meshes
+ShaderVariant* wait_shader_variant(ShaderVariants* shaders, unsigned int features) {
+    ShaderVariant* variant = get_shader_variant(shaders, features);
+    if (variant -> state == VARIANT_COMPILING) finish_shader_variant(shaders, variant);
+    return variant;
+}
+
+// Binds the variant and uploads the frame uniforms when it has not seen them yet.
+// A variant still compiling or that failed to build falls back to the one with the same pipeline and no material feature,
+// which is waited for when needed. NULL when that fails too
+ShaderProgram* use_shader_variant(ShaderVariants* shaders, unsigned int features) {
+    ShaderVariant* variant = get_shader_variant(shaders, features);
+    if (!poll_shader_variant(shaders, variant)) variant = wait_shader_variant(shaders, features & PIPELINE_FEATURES);
+    if (variant -> state != VARIANT_READY) return NULL;
+
+    ShaderProgram* program = &(variant -> program);
+    use_program(program -> id);
+    if (variant -> frame != shaders -> frame_uniforms.frame) {
+        set_uniform_mat4(program -> camera_matrix, shaders -> frame_uniforms.camera_matrix.data);
+        set_uniform_vec3(program -> cam_pos, shaders -> frame_uniforms.cam_pos.data);
+        set_uniform_vec4(program -> light_color, shaders -> frame_uniforms.light_color.data);
+        variant -> frame = shaders -> frame_uniforms.frame;
+    }
+
+    return program;
+}
+
+// Rebuilds every variant from the current sources, a reload or a first build still running is dropped for the new one.
+// A dropped first build leaves its variant failed, the users fall back until the reload is swapped in.
+// The programs are swapped by begin_shader_frame once all the builds are done
+void reload_shader_variants(ShaderVariants* shaders) {
+    PROFILE_FUNCTION();
+    char defines[512];
+    shaders -> reloads_count = 0;
+    for (unsigned int i = 0; i < shaders -> variants.count; ++i) {
+        ShaderVariant* variant = GET_ELEMENT(ShaderVariant*, shaders -> variants, i);
+        if (variant -> state == VARIANT_COMPILING) {
+            cancel_shader_build(&(variant -> build));
+            variant -> state = VARIANT_FAILED;
+        }
+        if (variant -> is_reloading) cancel_shader_build(&(variant -> reload));
+
+        get_feature_defines(variant -> features, defines, sizeof(defines));
+        variant -> is_reloading = start_shader_build(&(variant -> reload), shaders -> vertex_path, shaders -> fragment_path, defines);
+        if (variant -> is_reloading) (shaders -> reloads_count)++;
+    }
+
+    (shaders -> changes_count)++;
+    debug_info("reloading %u shader variants\n", shaders -> reloads_count);
+
+    return;
+}
+
+// All or nothing across the variants, so a frame never mixes old and new shaders.
+// A variant whose build failed keeps its previous program, the new ones get their uniform locations resolved again
+static void swap_shader_variants(ShaderVariants* shaders) {
+    for (unsigned int i = 0; i < shaders -> variants.count; ++i) {
+        ShaderVariant* variant = GET_ELEMENT(ShaderVariant*, shaders -> variants, i);
+        if (variant -> is_reloading && !is_shader_build_done(&(variant -> reload))) return;
+    }
+
+    // The current program may be about to be deleted, and its name reused by a new one
+    use_program(0);
+
+    unsigned int failures_count = 0;
+    double latency = 0.0;
+    for (unsigned int i = 0; i < shaders -> variants.count; ++i) {
+        ShaderVariant* variant = GET_ELEMENT(ShaderVariant*, shaders -> variants, i);
+        if (!(variant -> is_reloading)) continue;
+        variant -> is_reloading = FALSE;
+
+        unsigned int program = finish_shader_build(&(variant -> reload));
+        latency = variant -> reload.latency > latency ? variant -> reload.latency : latency;
+        if (program == INT32_MAX) {
+            failures_count++;
+            continue;
+        }
+
+        if (variant -> state == VARIANT_READY) {
+            deallocate_uniform_table(variant -> program.id);
+            glDeleteProgram(variant -> program.id);
+        }
+        variant -> program = init_shader_program(program);
+        variant -> state = VARIANT_READY;
+        variant -> frame = 0;
+    }
+
+    if (failures_count) error_info("shader reload failed for %u of %u variants, they keep their previous program\n", failures_count, shaders -> reloads_count);
+    else debug_info("shader reload of %u variants done in %.2f ms\n", shaders -> reloads_count, latency * 1000.0);
+    shaders -> reloads_count = 0;
+    (shaders -> changes_count)++;
+
+    return;
+}
+
+// Every variant gets the new uniforms the next time it is used, a finished reload is swapped in first
+void begin_shader_frame(ShaderVariants* shaders, Mat4 camera_matrix, Vec3 cam_pos) {
+    if (shaders -> reloads_count) swap_shader_variants(shaders);
+    shaders -> frame_uniforms.camera_matrix = camera_matrix;
+    shaders -> frame_uniforms.cam_pos = cam_pos;
+    (shaders -> frame_uniforms.frame)++;
+    return;
+}
+
+void deallocate_shader_variants(ShaderVariants* shaders) {
+    for (unsigned int i = 0; i < shaders -> variants.count; ++i) {
+        ShaderVariant* variant = GET_ELEMENT(ShaderVariant*, shaders -> variants, i);
+        if (variant -> state == VARIANT_COMPILING) cancel_shader_build(&(variant -> build));
+        if (variant -> is_reloading) cancel_shader_build(&(variant -> reload));
+        if (variant -> state == VARIANT_READY) {
+            deallocate_uniform_table(variant -> program.id);
+            glDeleteProgram(variant -> program.id);
+        }
+        free(variant);
+    }
+    deallocate_arr(shaders -> variants);
+    free(shaders -> vertex_path);
+    free(shaders -> fragment_path);
+    return;
+}
+
+#endif //_SHADER_VARIANTS_H_
@@ -0,0 +1,79 @@
+#ifndef _SHADER_WATCHER_H_
+#define _SHADER_WATCHER_H_
+
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "./utils.h"
+
+// Non-blocking inotify watch on the shader directory, polled once per frame.
+// Editors either rewrite the file in place or write a temporary and rename it over, so both events count as a change
+#define SHADER_WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+typedef struct ShaderWatcher {
+    int fd;
+    int watch;
+} ShaderWatcher;
+
+/* DECLARATIONS */
+
+bool init_shader_watcher(ShaderWatcher* watcher, const char* directory);
+bool poll_shader_watcher(ShaderWatcher* watcher, const char* vertex_path, const char* fragment_path);
+void close_shader_watcher(ShaderWatcher* watcher);
+
+/* ----------------------------------------------- */
+
+// A watcher that failed to start reports no change, the renderer just runs without hot reload
+bool init_shader_watcher(ShaderWatcher* watcher, const char* directory) {
+    *watcher = (ShaderWatcher) { .fd = -1, .watch = -1 };
+
+    watcher -> fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher -> fd < 0) {
+        error_info("failed to init inotify, shader hot reload is disabled\n");
+        return FALSE;
+    }
+
+    watcher -> watch = inotify_add_watch(watcher -> fd, directory, SHADER_WATCH_EVENTS);
+    if (watcher -> watch < 0) {
+        error_info("failed to watch '%s', shader hot reload is disabled\n", directory);
+        close_shader_watcher(watcher);
+        return FALSE;
+    }
+
+    debug_info("watching '%s' for shader changes\n", directory);
+
+    return TRUE;
+}
+
+static bool is_watched_shader(const char* name, const char* path) {
+    const char* file_name = strrchr(path, '/');
+    file_name = file_name != NULL ? file_name + 1 : path;
+    return !strcmp(name, file_name);
+}
+
+// Drains every pending event, returns TRUE when one of them touched either shader
+bool poll_shader_watcher(ShaderWatcher* watcher, const char* vertex_path, const char* fragment_path) {
+    if (watcher -> fd < 0) return FALSE;
+
+    // Aligned as the kernel expects, one read returns as many whole events as fit
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool is_changed = FALSE;
+    ssize_t length = 0;
+    while ((length = read(watcher -> fd, buffer, sizeof(buffer))) > 0) {
+        for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + ((struct inotify_event*) ptr) -> len) {
+            struct inotify_event* event = (struct inotify_event*) ptr;
+            if (!(event -> mask & SHADER_WATCH_EVENTS) || event -> len == 0) continue;
+            is_changed = is_changed || is_watched_shader(event -> name, vertex_path) || is_watched_shader(event -> name, fragment_path);
+        }
+    }
+
+    return is_changed;
+}
+
+void close_shader_watcher(ShaderWatcher* watcher) {
+    if (watcher -> fd >= 0) close(watcher -> fd);
+    watcher -> fd = -1;
+    watcher -> watch = -1;
+    return;
+}
+
+#endif //_SHADER_WATCHER_H_
@@ -0,0 +1,349 @@
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+#include "./types.h"
+
+#ifdef _SIMD_BENCHMARK_
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#endif
+
+#if defined(__SSE__)
+#define _SIMD_X86_
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define _SIMD_NEON_
+#include <arm_neon.h>
+#endif
+
+// NOTE: every kernel accumulates in the same order as the scalar fallback, so all the variants return bit-identical results
+
+typedef Mat4 (*Mat4MulKernel)(Mat4 a, Mat4 b);
+typedef Vec4 (*Mat4MulVec4Kernel)(Mat4 mat, Vec4 vec);
+typedef void (*Mat4MulBatchKernel)(Mat4 a, const Mat4* src, Mat4* dest, unsigned int count);
+
+/* DECLARATIONS */
+
+static Mat4 mat4_mul_resolve(Mat4 a, Mat4 b);
+static Vec4 mat4_mul_vec4_resolve(Mat4 mat, Vec4 vec);
+static void mat4_mul_batch_resolve(Mat4 a, const Mat4* src, Mat4* dest, unsigned int count);
+const char* simd_kernels_name(void);
+#ifdef _SIMD_BENCHMARK_
+void benchmark_simd_kernels(void);
+#endif
+
+/* ----------------------------------------------- */
+
+static Mat4MulKernel mat4_mul_kernel = mat4_mul_resolve;
+static Mat4MulVec4Kernel mat4_mul_vec4_kernel = mat4_mul_vec4_resolve;
+static Mat4MulBatchKernel mat4_mul_batch_kernel = mat4_mul_batch_resolve;
+static const char* selected_simd_kernels = NULL;
+
+/* SCALAR */
+
+static Mat4 mat4_mul_scalar(Mat4 a, Mat4 b) {
+    Mat4 result = {0};
+
+    for (unsigned int row = 0; row < 4; ++row) {
+        for (unsigned int i = 0; i < 4; ++i) {
+            for (unsigned int col = 0; col < 4; ++col) {
+                result.data[row * 4 + col] += a.data[row * 4 + i] * b.data[i * 4 + col];
+            }
+        }
+    }
+
+    return result;
+}
+
+static Vec4 mat4_mul_vec4_scalar(Mat4 mat, Vec4 vec) {
+    Vec4 result = {0};
+
+    for (unsigned int i = 0; i < 4; ++i) {
+        for (unsigned int row = 0; row < 4; ++row) {
+            result.data[row] += mat.data[row * 4 + i] * vec.data[i];
+        }
+    }
+
+    return result;
+}
+
+static void mat4_mul_batch_scalar(Mat4 a, const Mat4* src, Mat4* dest, unsigned int count) {
+    for (unsigned int i = 0; i < count; ++i) {
+        dest[i] = mat4_mul_scalar(a, src[i]);
+    }
+    return;
+}
+
+#ifdef _SIMD_X86_
+
+/* SSE */
+
+static inline void mat4_mul_sse_store(const float* a, const float* b, float* dest) {
+    __m128 b0 = _mm_loadu_ps(b);
+    __m128 b1 = _mm_loadu_ps(b + 4);
+    __m128 b2 = _mm_loadu_ps(b + 8);
+    __m128 b3 = _mm_loadu_ps(b + 12);
+
+    // result[row] = b[0] * a[row][0] + b[1] * a[row][1] + b[2] * a[row][2] + b[3] * a[row][3]
+    for (unsigned int row = 0; row < 4; ++row) {
+        __m128 result = _mm_mul_ps(_mm_set1_ps(a[row * 4]), b0);
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(a[row * 4 + 1]), b1));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(a[row * 4 + 2]), b2));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(a[row * 4 + 3]), b3));
+        _mm_storeu_ps(dest + row * 4, result);
+    }
+
+    return;
+}
+
+static Mat4 mat4_mul_sse(Mat4 a, Mat4 b) {
+    Mat4 result;
+    mat4_mul_sse_store(a.data, b.data, result.data);
+    return result;
+}
+
+static Vec4 mat4_mul_vec4_sse(Mat4 mat, Vec4 vec) {
+    // Transpose the rows to get the columns, then result = col0 * v[0] + col1 * v[1] + col2 * v[2] + col3 * v[3]
+    __m128 col0 = _mm_loadu_ps(mat.data);
+    __m128 col1 = _mm_loadu_ps(mat.data + 4);
+    __m128 col2 = _mm_loadu_ps(mat.data + 8);
+    __m128 col3 = _mm_loadu_ps(mat.data + 12);
+    _MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+
+    __m128 result = _mm_mul_ps(col0, _mm_set1_ps(vec.data[0]));
+    result = _mm_add_ps(result, _mm_mul_ps(col1, _mm_set1_ps(vec.data[1])));
+    result = _mm_add_ps(result, _mm_mul_ps(col2, _mm_set1_ps(vec.data[2])));
+    result = _mm_add_ps(result, _mm_mul_ps(col3, _mm_set1_ps(vec.data[3])));
+
+    Vec4 res;
+    _mm_storeu_ps(res.data, result);
+
+    return res;
+}
+
+static void mat4_mul_batch_sse(Mat4 a, const Mat4* src, Mat4* dest, unsigned int count) {
+    for (unsigned int i = 0; i < count; ++i) {
+        mat4_mul_sse_store(a.data, src[i].data, dest[i].data);
+    }
+    return;
+}
+
+/* AVX */
+
+// Compute two rows at once: the low lane holds a[row], the high lane a[row + 1]
+__attribute__((target("avx"))) static inline void mat4_mul_avx_store(const float* a, const float* b, float* dest) {
+    __m256 b0 = _mm256_broadcast_ps((const __m128*) b);
+    __m256 b1 = _mm256_broadcast_ps((const __m128*) (b + 4));
+    __m256 b2 = _mm256_broadcast_ps((const __m128*) (b + 8));
+    __m256 b3 = _mm256_broadcast_ps((const __m128*) (b + 12));
+
+    for (unsigned int row = 0; row < 4; row += 2) {
+        __m256 a_rows = _mm256_loadu_ps(a + row * 4);
+        __m256 result = _mm256_mul_ps(_mm256_permute_ps(a_rows, 0x00), b0);
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(a_rows, 0x55), b1));
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(a_rows, 0xAA), b2));
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_permute_ps(a_rows, 0xFF), b3));
+        _mm256_storeu_ps(dest + row * 4, result);
+    }
+
+    return;
+}
+
+__attribute__((target("avx"))) static void mat4_mul_batch_avx(Mat4 a, const Mat4* src, Mat4* dest, unsigned int count) {
+    for (unsigned int i = 0; i < count; ++i) {
+        mat4_mul_avx_store(a.data, src[i].data, dest[i].data);
+    }
+    return;
+}
+
+#endif //_SIMD_X86_
+
+#ifdef _SIMD_NEON_
+
+/* NEON */
+
+static inline void mat4_mul_neon_store(const float* a, const float* b, float* dest) {
+    float32x4_t b0 = vld1q_f32(b);
+    float32x4_t b1 = vld1q_f32(b + 4);
+    float32x4_t b2 = vld1q_f32(b + 8);
+    float32x4_t b3 = vld1q_f32(b + 12);
+
+    for (unsigned int row = 0; row < 4; ++row) {
+        float32x4_t result = vmulq_n_f32(b0, a[row * 4]);
+        result = vaddq_f32(result, vmulq_n_f32(b1, a[row * 4 + 1]));
+        result = vaddq_f32(result, vmulq_n_f32(b2, a[row * 4 + 2]));
+        result = vaddq_f32(result, vmulq_n_f32(b3, a[row * 4 + 3]));
+        vst1q_f32(dest + row * 4, result);
+    }
+
+    return;
+}
+
+static Mat4 mat4_mul_neon(Mat4 a, Mat4 b) {
+    Mat4 result;
+    mat4_mul_neon_store(a.data, b.data, result.data);
+    return result;
+}
+
+static Vec4 mat4_mul_vec4_neon(Mat4 mat, Vec4 vec) {
+    // The de-interleaving load returns the columns of the row-major matrix
+    float32x4x4_t cols = vld4q_f32(mat.data);
+
+    float32x4_t result = vmulq_n_f32(cols.val[0], vec.data[0]);
+    result = vaddq_f32(result, vmulq_n_f32(cols.val[1], vec.data[1]));
+    result = vaddq_f32(result, vmulq_n_f32(cols.val[2], vec.data[2]));
+    result = vaddq_f32(result, vmulq_n_f32(cols.val[3], vec.data[3]));
+
+    Vec4 res;
+    vst1q_f32(res.data, result);
+
+    return res;
+}
+
+static void mat4_mul_batch_neon(Mat4 a, const Mat4* src, Mat4* dest, unsigned int count) {
+    for (unsigned int i = 0; i < count; ++i) {
+        mat4_mul_neon_store(a.data, src[i].data, dest[i].data);
+    }
+    return;
+}
+
+#endif //_SIMD_NEON_
+
+/* DISPATCH */
+
+// The first call may come from any thread, even from several at once, so the pointers are published with atomic stores.
+// Every thread resolves to the same kernels and each one is valid on its own, so the order of the stores does not matter
+static void select_simd_kernels(void) {
+    Mat4MulKernel mul = mat4_mul_scalar;
+    Mat4MulVec4Kernel mul_vec4 = mat4_mul_vec4_scalar;
+    Mat4MulBatchKernel mul_batch = mat4_mul_batch_scalar;
+    const char* name = "scalar";
+
+#if defined(_SIMD_X86_)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse")) {
+        mul = mat4_mul_sse;
+        mul_vec4 = mat4_mul_vec4_sse;
+        mul_batch = mat4_mul_batch_sse;
+        name = "sse";
+    }
+
+    // A single product is too short to amortize the lane shuffles, so AVX is only used for batches
+    if (__builtin_cpu_supports("avx")) {
+        mul_batch = mat4_mul_batch_avx;
+        name = "sse/avx";
+    }
+#elif defined(_SIMD_NEON_)
+    mul = mat4_mul_neon;
+    mul_vec4 = mat4_mul_vec4_neon;
+    mul_batch = mat4_mul_batch_neon;
+    name = "neon";
+#endif
+
+    __atomic_store_n(&mat4_mul_kernel, mul, __ATOMIC_RELAXED);
+    __atomic_store_n(&mat4_mul_vec4_kernel, mul_vec4, __ATOMIC_RELAXED);
+    __atomic_store_n(&mat4_mul_batch_kernel, mul_batch, __ATOMIC_RELAXED);
+    __atomic_store_n(&selected_simd_kernels, name, __ATOMIC_RELAXED);
+
+    return;
+}
+
+// The kernels start pointing to these stubs, which pick the best implementation on the first call
+static Mat4 mat4_mul_resolve(Mat4 a, Mat4 b) {
+    select_simd_kernels();
+    return __atomic_load_n(&mat4_mul_kernel, __ATOMIC_RELAXED)(a, b);
+}
+
+static Vec4 mat4_mul_vec4_resolve(Mat4 mat, Vec4 vec) {
+    select_simd_kernels();
+    return __atomic_load_n(&mat4_mul_vec4_kernel, __ATOMIC_RELAXED)(mat, vec);
+}
+
+static void mat4_mul_batch_resolve(Mat4 a, const Mat4* src, Mat4* dest, unsigned int count) {
+    select_simd_kernels();
+    __atomic_load_n(&mat4_mul_batch_kernel, __ATOMIC_RELAXED)(a, src, dest, count);
+    return;
+}
+
+const char* simd_kernels_name(void) {
+    if (__atomic_load_n(&selected_simd_kernels, __ATOMIC_RELAXED) == NULL) select_simd_kernels();
+    return __atomic_load_n(&selected_simd_kernels, __ATOMIC_RELAXED);
+}
+
+#ifdef _SIMD_BENCHMARK_
+
+/* BENCHMARK */
+
+#define SIMD_BENCHMARK_BATCH 4096
+#define SIMD_BENCHMARK_ROUNDS 2000
+
+typedef struct SimdKernels {
+    const char* name;
+    Mat4MulKernel mul;
+    Mat4MulVec4Kernel mul_vec4;
+    Mat4MulBatchKernel mul_batch;
+} SimdKernels;
+
+static double get_benchmark_time(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// Times each variant the CPU supports on the same operands, and checks it against the scalar results
+void benchmark_simd_kernels(void) {
+    SimdKernels variants[4] = { { "scalar", mat4_mul_scalar, mat4_mul_vec4_scalar, mat4_mul_batch_scalar } };
+    unsigned int variants_count = 1;
+#if defined(_SIMD_X86_)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse")) variants[variants_count++] = (SimdKernels) { "sse", mat4_mul_sse, mat4_mul_vec4_sse, mat4_mul_batch_sse };
+    if (__builtin_cpu_supports("avx")) variants[variants_count++] = (SimdKernels) { "avx (batch)", mat4_mul_sse, mat4_mul_vec4_sse, mat4_mul_batch_avx };
+#elif defined(_SIMD_NEON_)
+    variants[variants_count++] = (SimdKernels) { "neon", mat4_mul_neon, mat4_mul_vec4_neon, mat4_mul_batch_neon };
+#endif
+
+    Mat4* src = (Mat4*) calloc(SIMD_BENCHMARK_BATCH, sizeof(Mat4));
+    Mat4* dest = (Mat4*) calloc(SIMD_BENCHMARK_BATCH, sizeof(Mat4));
+    Mat4* reference = (Mat4*) calloc(SIMD_BENCHMARK_BATCH, sizeof(Mat4));
+    Mat4 a = {0};
+    for (unsigned int i = 0; i < 16; ++i) a.data[i] = (float) (i % 5) * 0.25f - 0.5f;
+    for (unsigned int i = 0; i < SIMD_BENCHMARK_BATCH; ++i) {
+        for (unsigned int j = 0; j < 16; ++j) src[i].data[j] = (float) ((i * 16 + j) % 17) * 0.125f - 1.0f;
+    }
+    mat4_mul_batch_scalar(a, src, reference, SIMD_BENCHMARK_BATCH);
+
+    const unsigned int products = SIMD_BENCHMARK_BATCH * SIMD_BENCHMARK_ROUNDS;
+    for (unsigned int v = 0; v < variants_count; ++v) {
+        SimdKernels* kernels = variants + v;
+
+        // Every result is summed and printed, so the calls cannot be dropped
+        float sum = 0.0f;
+        double start = get_benchmark_time();
+        for (unsigned int i = 0; i < products; ++i) sum += kernels -> mul(a, src[i & (SIMD_BENCHMARK_BATCH - 1)]).data[i & 15];
+        double mul_time = get_benchmark_time() - start;
+
+        Vec4 vec = {{ 1.0f, 0.5f, 0.25f, 1.0f }};
+        start = get_benchmark_time();
+        for (unsigned int i = 0; i < products; ++i) sum += kernels -> mul_vec4(src[i & (SIMD_BENCHMARK_BATCH - 1)], vec).data[i & 3];
+        double mul_vec4_time = get_benchmark_time() - start;
+
+        start = get_benchmark_time();
+        for (unsigned int i = 0; i < SIMD_BENCHMARK_ROUNDS; ++i) kernels -> mul_batch(a, src, dest, SIMD_BENCHMARK_BATCH);
+        double batch_time = get_benchmark_time() - start;
+
+        bool is_exact = !memcmp(dest, reference, SIMD_BENCHMARK_BATCH * sizeof(Mat4));
+        printf("%-12s mat4_mul %6.2f ns, mat4_mul_vec4 %6.2f ns, mat4_mul_batch %6.2f ns per matrix, %s (checksum %g)\n", kernels -> name, mul_time * 1e9 / products, mul_vec4_time * 1e9 / products, batch_time * 1e9 / products, is_exact ? "bit-identical" : "MISMATCH", sum);
+    }
+
+    free(src);
+    free(dest);
+    free(reference);
+
+    return;
+}
+
+#endif //_SIMD_BENCHMARK_
+
+#endif //_SIMD_H_
@@ -5,31 +5,123 @@
 #include "../../libs/image_io.h"
 #include "./types.h"
 #include "./utils.h"
+#include "./thread_pool.h"
+#include "./texture_cache.h"
+#include "./extensions.h"
+#include "./profiler.h"
+#include <stdint.h>
+#include "./GLFW/glfw3.h"
 
 const unsigned short int values_filter[] = { GL_NEAREST, GL_LINEAR, GL_NEAREST_MIPMAP_NEAREST, GL_LINEAR_MIPMAP_NEAREST, GL_NEAREST_MIPMAP_LINEAR, GL_LINEAR_MIPMAP_LINEAR };
 const unsigned short int values_wrap[] = { GL_CLAMP_TO_EDGE, GL_MIRRORED_REPEAT, GL_REPEAT };
+const char* texture_type_str[] = { "base_color_texture", "metallic_roughness_texture", "normal_texture", "occlusion_texture", "emissive_texture" };
+const unsigned int values_compressed_format[] = { 0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RG_RGTC2 };
 
-void load_texture(const char* file_path, unsigned int* texture_id, TextureParams texture_params) {
-    glGenTextures(1, texture_id);
+// Ring of pixel unpack buffers each texture queue streams its uploads through
+#define PIXEL_BUFFERS_COUNT 4
+// Larger mip chains are uploaded straight from client memory instead of growing a buffer past this
+#define PIXEL_BUFFER_MAX_SIZE (64ULL * 1024 * 1024)
+
+// A buffer is free once its fence has signaled, the upload it fed has been consumed by the driver
+typedef struct PixelBuffer {
+    unsigned int id;
+    unsigned long long int capacity;
+    GLsync fence;
+    bool is_mapped;
+} PixelBuffer;
+
+// Mip chain waiting in the completion queue for its upload
+typedef struct TextureJob {
+    char* path;
+    TextureType type;
+    bool compress;
+    unsigned int texture_id;
+    TextureParams texture_params;
+    unsigned long long int* vram_size;
+    TextureCache* cache;
+    bool is_cache_hit;
+    double decode_time;
+    PixelBuffer* pixel_buffer;
+    void* mapped_data;
+    struct TextureQueue* queue;
+    struct TextureJob* next;
+} TextureJob;
+
+// Decodes run on the worker pool, then a worker copies the mip chain into a mapped pixel buffer
+// and the context thread only issues the uploads out of it.
+// NOTE: the pixel buffers are only touched by the context thread, the lock guards the two lists and the counters
+typedef struct TextureQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t job_completed;
+    TextureJob* completed_head;
+    TextureJob* completed_tail;
+    TextureJob* copied_head;
+    TextureJob* copied_tail;
+    PixelBuffer pixel_buffers[PIXEL_BUFFERS_COUNT];
+    unsigned int pending_jobs;
+    unsigned int uploaded_count;
+    unsigned int cache_hits;
+    unsigned int direct_uploads;
+    double start_time;
+    double decode_time;
+    double upload_time;
+} TextureQueue;
 
+/* DECLARATIONS */
+
+Image decode_texture(const char* file_path);
+void upload_texture(Image image, unsigned int texture_id, TextureParams texture_params);
+bool enable_texture_compression(void);
+TextureCache* load_texture_cache(const char* file_path, TextureType type, bool compress, bool* is_cache_hit);
+unsigned long long int upload_texture_cache(TextureCache* cache, unsigned int texture_id, TextureParams texture_params);
+void load_texture(const char* file_path, unsigned int* texture_id, TextureParams texture_params);
+void upload_placeholder_texture(unsigned int texture_id, const unsigned char* texel);
+void init_texture_queue(TextureQueue* queue);
+void queue_texture(TextureQueue* queue, char* file_path, TextureType type, unsigned int* texture_id, TextureParams texture_params, unsigned long long int* vram_size);
+unsigned int drain_texture_queue(TextureQueue* queue, bool wait);
+void deallocate_texture_queue(TextureQueue* queue);
+void queue_warm_texture(const char* file_path, TextureType type, bool compress);
+void benchmark_texture_compression(const char* file_path);
+bool verify_mip_chain(const char* file_path);
+
+/* ----------------------------------------------- */
+
+static bool is_texture_compression_enabled = FALSE;
+
+// NOTE: touches no GL state, so it can run on any thread
+Image decode_texture(const char* file_path) {
     debug_info("decoding image: '%s' ...\n", file_path);
+    PROFILE_SCOPE("decode_image");
     Image image = decode_image(file_path);
 
     if (image.error) {
         error_info("Texture failed to load at path: %s, with error: %s\n", file_path, err_codes[image.error]);
         deallocate_image(image);
-        *texture_id = -1;
-        return;
+        image.decoded_data = NULL;
     }
 
+    return image;
+}
+
+// Gray and alpha images are stored as RG, the swizzle spreads the gray over the color channels and moves the alpha back
+static void set_texture_swizzle(unsigned int components) {
+    if (components != 2) return;
+    const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    return;
+}
+
+void upload_texture(Image image, unsigned int texture_id, TextureParams texture_params) {
     GLenum format = 0;
     if (image.components == 1) format = GL_RED;
+    else if (image.components == 2) format = GL_RG;
     else if (image.components == 3) format = GL_RGB;
     else if (image.components == 4) format = GL_RGBA;
 
-    glBindTexture(GL_TEXTURE_2D, *texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
     glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.decoded_data);
     glGenerateMipmap(GL_TEXTURE_2D);
+    set_texture_swizzle(image.components);
 
     // Pass from Texture struct
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, values_wrap[texture_params.wrap_s]);
@@ -37,11 +129,419 @@ void load_texture(const char* file_path, unsigned int* texture_id, TextureParams
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, values_filter[texture_params.min_filter]);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, values_filter[texture_params.mag_filter]);
 
+    return;
+}
+
+// The textures queued from now on are block compressed, returns FALSE when the driver cannot sample them
+bool enable_texture_compression(void) {
+    is_texture_compression_enabled = GLAD_GL_EXT_texture_compression_s3tc;
+    if (!is_texture_compression_enabled) error_info("s3tc is not supported, the textures stay uncompressed\n");
+    return is_texture_compression_enabled;
+}
+
+// The cached mip chain when it is up to date, otherwise the image is decoded and its cache rebuilt.
+// NOTE: touches no GL state, so it can run on any thread
+TextureCache* load_texture_cache(const char* file_path, TextureType type, bool compress, bool* is_cache_hit) {
+    TextureCache* cache = open_texture_cache(file_path, type, compress);
+    if (is_cache_hit != NULL) *is_cache_hit = cache != NULL;
+    if (cache != NULL) return cache;
+
+    Image image = decode_texture(file_path);
+    if (image.error) return NULL;
+
+    cache = build_texture_cache(file_path, image, type, compress);
     deallocate_image(image);
 
+    return cache;
+}
+
+// The levels are read at their file offsets from base, which is either the cache in client memory
+// or 0 with a pixel buffer holding a copy of the file bound to GL_PIXEL_UNPACK_BUFFER
+static unsigned long long int upload_texture_levels(TextureCacheHeader* header, uintptr_t base, unsigned int texture_id, TextureParams texture_params) {
+    unsigned long long int uploaded_size = 0;
+    GLenum format = 0;
+    if (header -> components == 1) format = GL_RED;
+    else if (header -> components == 2) format = GL_RG;
+    else if (header -> components == 3) format = GL_RGB;
+    else if (header -> components == 4) format = GL_RGBA;
+
+    // The rows of the smaller levels are not padded to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    for (unsigned int i = 0; i < header -> levels_count; ++i) {
+        TextureCacheLevel level = header -> levels[i];
+        if (header -> format == TEXTURE_FORMAT_RAW) {
+            glTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, (const void*) (base + level.offset));
+        } else {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, values_compressed_format[header -> format], level.width, level.height, 0, level.size, (const void*) (base + level.offset));
+        }
+        uploaded_size += level.size;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header -> levels_count - 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    set_texture_swizzle(header -> components);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, values_wrap[texture_params.wrap_s]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, values_wrap[texture_params.wrap_t]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, values_filter[texture_params.min_filter]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, values_filter[texture_params.mag_filter]);
+
+    return uploaded_size;
+}
+
+// One upload per level, the chain is complete so glGenerateMipmap is not needed. Returns the bytes uploaded
+unsigned long long int upload_texture_cache(TextureCache* cache, unsigned int texture_id, TextureParams texture_params) {
+    return upload_texture_levels(cache -> header, (uintptr_t) (cache -> data), texture_id, texture_params);
+}
+
+void load_texture(const char* file_path, unsigned int* texture_id, TextureParams texture_params) {
+    glGenTextures(1, texture_id);
+
+    TextureCache* cache = load_texture_cache(file_path, BASE_COLOR_TEXTURE, FALSE, NULL);
+    if (cache == NULL) {
+        *texture_id = -1;
+        return;
+    }
+
+    upload_texture_cache(cache, *texture_id, texture_params);
+    close_texture_cache(cache);
+
     debug_info("texture successfully loaded\n");
 
     return;
 }
 
+// Single texel image shown until the real one is uploaded
+void upload_placeholder_texture(unsigned int texture_id, const unsigned char* texel) {
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return;
+}
+
+void init_texture_queue(TextureQueue* queue) {
+    *queue = (TextureQueue) {0};
+    pthread_mutex_init(&(queue -> lock), NULL);
+    pthread_cond_init(&(queue -> job_completed), NULL);
+    queue -> start_time = glfwGetTime();
+    return;
+}
+
+static void push_texture_job(TextureQueue* queue, TextureJob** head, TextureJob** tail, TextureJob* job) {
+    pthread_mutex_lock(&(queue -> lock));
+    job -> next = NULL;
+    if (*tail != NULL) (*tail) -> next = job;
+    else *head = job;
+    *tail = job;
+    pthread_cond_signal(&(queue -> job_completed));
+    pthread_mutex_unlock(&(queue -> lock));
+    return;
+}
+
+static TextureJob* pop_texture_job(TextureJob** head, TextureJob** tail) {
+    TextureJob* job = *head;
+    *head = job -> next;
+    if (*head == NULL) *tail = NULL;
+    return job;
+}
+
+static void decode_texture_job(void* args) {
+    PROFILE_FUNCTION();
+    TextureJob* job = (TextureJob*) args;
+    double start = glfwGetTime();
+    job -> cache = load_texture_cache(job -> path, job -> type, job -> compress, &(job -> is_cache_hit));
+    job -> decode_time = glfwGetTime() - start;
+    push_texture_job(job -> queue, &(job -> queue -> completed_head), &(job -> queue -> completed_tail), job);
+    return;
+}
+
+// The whole file is copied, so the level offsets stay valid inside the buffer
+static void copy_texture_job(void* args) {
+    PROFILE_FUNCTION();
+    TextureJob* job = (TextureJob*) args;
+    memcpy(job -> mapped_data, job -> cache -> data, job -> cache -> size);
+    push_texture_job(job -> queue, &(job -> queue -> copied_head), &(job -> queue -> copied_tail), job);
+    return;
+}
+
+// The texture name is generated right away, so it can be bound before the image is uploaded.
+// The type picks the compressed format, when vram_size is not NULL it receives the size of the uploaded mip chain
+void queue_texture(TextureQueue* queue, char* file_path, TextureType type, unsigned int* texture_id, TextureParams texture_params, unsigned long long int* vram_size) {
+    glGenTextures(1, texture_id);
+
+    TextureJob* job = (TextureJob*) calloc(1, sizeof(TextureJob));
+    job -> path = file_path;
+    job -> type = type;
+    job -> compress = is_texture_compression_enabled;
+    job -> texture_id = *texture_id;
+    job -> texture_params = texture_params;
+    job -> vram_size = vram_size;
+    job -> queue = queue;
+
+    pthread_mutex_lock(&(queue -> lock));
+    (queue -> pending_jobs)++;
+    pthread_mutex_unlock(&(queue -> lock));
+
+    submit_job(get_worker_pool(), decode_texture_job, job);
+
+    return;
+}
+
+// Frees the buffers whose uploads the driver has consumed, never blocks
+static void retire_pixel_buffers(TextureQueue* queue) {
+    for (unsigned int i = 0; i < PIXEL_BUFFERS_COUNT; ++i) {
+        PixelBuffer* pixel_buffer = queue -> pixel_buffers + i;
+        if (pixel_buffer -> fence == NULL) continue;
+        GLenum status = glClientWaitSync(pixel_buffer -> fence, 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            glDeleteSync(pixel_buffer -> fence);
+            pixel_buffer -> fence = NULL;
+        }
+    }
+    return;
+}
+
+static PixelBuffer* find_free_pixel_buffer(TextureQueue* queue) {
+    for (unsigned int i = 0; i < PIXEL_BUFFERS_COUNT; ++i) {
+        PixelBuffer* pixel_buffer = queue -> pixel_buffers + i;
+        if (pixel_buffer -> fence == NULL && !(pixel_buffer -> is_mapped)) return pixel_buffer;
+    }
+    return NULL;
+}
+
+// Only called when every buffer is busy and the caller asked to wait, blocks on the first fence
+static void wait_pixel_buffer(TextureQueue* queue) {
+    for (unsigned int i = 0; i < PIXEL_BUFFERS_COUNT; ++i) {
+        PixelBuffer* pixel_buffer = queue -> pixel_buffers + i;
+        if (pixel_buffer -> fence == NULL) continue;
+        while (glClientWaitSync(pixel_buffer -> fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(pixel_buffer -> fence);
+        pixel_buffer -> fence = NULL;
+        return;
+    }
+    return;
+}
+
+static bool has_fenced_pixel_buffer(TextureQueue* queue) {
+    for (unsigned int i = 0; i < PIXEL_BUFFERS_COUNT; ++i) {
+        if (queue -> pixel_buffers[i].fence != NULL) return TRUE;
+    }
+    return FALSE;
+}
+
+// Maps the buffer for the copy on a worker, the fence already guarantees the driver is done with the old content.
+// Returns FALSE when the chain must be uploaded from client memory instead
+static bool map_pixel_buffer(PixelBuffer* pixel_buffer, TextureJob* job) {
+    if (job -> cache -> size > PIXEL_BUFFER_MAX_SIZE) return FALSE;
+
+    if (pixel_buffer -> id == 0) glGenBuffers(1, &(pixel_buffer -> id));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer -> id);
+    if (pixel_buffer -> capacity < job -> cache -> size) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, job -> cache -> size, NULL, GL_STREAM_DRAW);
+        pixel_buffer -> capacity = job -> cache -> size;
+    }
+    job -> mapped_data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, job -> cache -> size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (job -> mapped_data == NULL) return FALSE;
+
+    pixel_buffer -> is_mapped = TRUE;
+    job -> pixel_buffer = pixel_buffer;
+
+    return TRUE;
+}
+
+// Issues the uploads out of the pixel buffer and fences them, the copy to VRAM happens asynchronously.
+// Falls back to client memory when the buffer content was lost while mapped
+static unsigned long long int upload_pixel_buffer(TextureJob* job) {
+    PixelBuffer* pixel_buffer = job -> pixel_buffer;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer -> id);
+    bool is_valid = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    pixel_buffer -> is_mapped = FALSE;
+
+    unsigned long long int uploaded_size = 0;
+    if (is_valid) {
+        uploaded_size = upload_texture_levels(job -> cache -> header, 0, job -> texture_id, job -> texture_params);
+        pixel_buffer -> fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!is_valid) uploaded_size = upload_texture_cache(job -> cache, job -> texture_id, job -> texture_params);
+
+    return uploaded_size;
+}
+
+static void finish_texture_job(TextureQueue* queue, TextureJob* job, unsigned long long int uploaded_size) {
+    if (job -> vram_size != NULL) *(job -> vram_size) = uploaded_size;
+    close_texture_cache(job -> cache);
+    queue -> cache_hits += job -> is_cache_hit;
+    queue -> decode_time += job -> decode_time;
+    free(job);
+
+    pthread_mutex_lock(&(queue -> lock));
+    (queue -> pending_jobs)--;
+    pthread_mutex_unlock(&(queue -> lock));
+
+    return;
+}
+
+// Moves every texture one step down the pipeline: decoded chains get a free pixel buffer and a copy job,
+// copied ones are uploaded. Without wait it never blocks, what cannot progress is left for the next call.
+// With wait it returns once every queued texture is uploaded
+unsigned int drain_texture_queue(TextureQueue* queue, bool wait) {
+    PROFILE_FUNCTION();
+    unsigned int uploaded = 0;
+
+    while (TRUE) {
+        retire_pixel_buffers(queue);
+        PixelBuffer* pixel_buffer = find_free_pixel_buffer(queue);
+
+        pthread_mutex_lock(&(queue -> lock));
+        TextureJob* copied_job = queue -> copied_head != NULL ? pop_texture_job(&(queue -> copied_head), &(queue -> copied_tail)) : NULL;
+        TextureJob* decoded_job = (pixel_buffer != NULL && queue -> completed_head != NULL) ? pop_texture_job(&(queue -> completed_head), &(queue -> completed_tail)) : NULL;
+        if (copied_job == NULL && decoded_job == NULL) {
+            if (!wait || queue -> pending_jobs == 0) {
+                pthread_mutex_unlock(&(queue -> lock));
+                break;
+            }
+
+            // A decode or a copy is still running when no buffer waits on its fence
+            if (!has_fenced_pixel_buffer(queue)) pthread_cond_wait(&(queue -> job_completed), &(queue -> lock));
+            pthread_mutex_unlock(&(queue -> lock));
+            wait_pixel_buffer(queue);
+            continue;
+        }
+        pthread_mutex_unlock(&(queue -> lock));
+
+        if (copied_job != NULL) {
+            double start = glfwGetTime();
+            unsigned long long int uploaded_size = upload_pixel_buffer(copied_job);
+            queue -> upload_time += glfwGetTime() - start;
+            finish_texture_job(queue, copied_job, uploaded_size);
+            uploaded++;
+        }
+
+        if (decoded_job != NULL) {
+            if (decoded_job -> cache == NULL) {
+                finish_texture_job(queue, decoded_job, 0);
+                uploaded++;
+            } else if (map_pixel_buffer(pixel_buffer, decoded_job)) submit_job(get_worker_pool(), copy_texture_job, decoded_job);
+            else {
+                double start = glfwGetTime();
+                unsigned long long int uploaded_size = upload_texture_cache(decoded_job -> cache, decoded_job -> texture_id, decoded_job -> texture_params);
+                queue -> upload_time += glfwGetTime() - start;
+                (queue -> direct_uploads)++;
+                finish_texture_job(queue, decoded_job, uploaded_size);
+                uploaded++;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&(queue -> lock));
+    bool is_done = queue -> pending_jobs == 0;
+    pthread_mutex_unlock(&(queue -> lock));
+
+    queue -> uploaded_count += uploaded;
+    if (uploaded && is_done) {
+        debug_info("%u textures ready in %.2f ms (%u from the texture cache, %u too large for the pixel buffers): decode %.2f ms (summed over the workers), upload calls %.2f ms\n", queue -> uploaded_count, (glfwGetTime() - queue -> start_time) * 1000.0, queue -> cache_hits, queue -> direct_uploads, queue -> decode_time * 1000.0, queue -> upload_time * 1000.0);
+    }
+
+    return uploaded;
+}
+
+// Waits for the decodes and copies still in flight, since they reference the queue.
+// The driver keeps deleted buffers alive until the fenced uploads are done
+void deallocate_texture_queue(TextureQueue* queue) {
+    drain_texture_queue(queue, TRUE);
+    for (unsigned int i = 0; i < PIXEL_BUFFERS_COUNT; ++i) {
+        PixelBuffer* pixel_buffer = queue -> pixel_buffers + i;
+        if (pixel_buffer -> fence != NULL) glDeleteSync(pixel_buffer -> fence);
+        if (pixel_buffer -> id) glDeleteBuffers(1, &(pixel_buffer -> id));
+    }
+    pthread_mutex_destroy(&(queue -> lock));
+    pthread_cond_destroy(&(queue -> job_completed));
+    return;
+}
+
+// Cache of one texture of a model, built ahead of time with the type and the compression the loader will ask for
+typedef struct WarmTextureJob {
+    char* path;
+    TextureType type;
+    bool compress;
+} WarmTextureJob;
+
+static void warm_texture_job(void* args) {
+    WarmTextureJob* job = (WarmTextureJob*) args;
+    bool is_cache_hit = FALSE;
+    TextureCache* cache = load_texture_cache(job -> path, job -> type, job -> compress, &is_cache_hit);
+    if (cache != NULL && !is_cache_hit) debug_info("cached '%s' as %s\n", job -> path, texture_type_str[job -> type]);
+    close_texture_cache(cache);
+    free(job -> path);
+    free(job);
+    return;
+}
+
+// Builds the cache on a worker when it is missing or stale, wait for it with wait_jobs
+void queue_warm_texture(const char* file_path, TextureType type, bool compress) {
+    WarmTextureJob* job = (WarmTextureJob*) calloc(1, sizeof(WarmTextureJob));
+    job -> path = (char*) calloc(strlen(file_path) + 1, sizeof(char));
+    strcpy(job -> path, file_path);
+    job -> type = type;
+    job -> compress = compress;
+    submit_job(get_worker_pool(), warm_texture_job, job);
+    return;
+}
+
+// Compression time and quality of every format on the level 0 of an image, against its raw size
+void benchmark_texture_compression(const char* file_path) {
+    Image image = decode_texture(file_path);
+    if (image.error) return;
+
+    debug_info("'%s': %ux%u, %u components, %u bytes uncompressed\n", file_path, image.width, image.height, image.components, image.size);
+    if (image.components < 3) {
+        error_info("images with less than three components are never compressed\n");
+        deallocate_image(image);
+        return;
+    }
+
+    for (TextureFormat format = TEXTURE_FORMAT_BC1; format <= TEXTURE_FORMAT_BC5; ++format) {
+        unsigned long long int size = get_texture_level_size(image.width, image.height, image.components, format);
+        unsigned char* compressed = (unsigned char*) malloc(size);
+
+        double start = get_wall_time();
+        compress_texture_level(image.decoded_data, image.width, image.height, image.components, format, compressed);
+        double compression_time = get_wall_time() - start;
+
+        double psnr = get_compression_psnr(image.decoded_data, image.width, image.height, image.components, format, compressed);
+        debug_info("%s: %.2f ms, %.2f dB PSNR, %llu bytes (%.1f:1)\n", texture_format_str[format], compression_time * 1000.0, psnr, size, (double) image.size / size);
+        free(compressed);
+    }
+
+    deallocate_image(image);
+
+    return;
+}
+
+// Checks the mip generator against its scalar reference, on an image or on a generated one when file_path is NULL
+bool verify_mip_chain(const char* file_path) {
+    Image image = {0};
+    if (file_path != NULL) {
+        image = decode_texture(file_path);
+        if (image.error) return FALSE;
+    } else {
+        image = (Image) { .width = 1027, .height = 515, .components = 4 };
+        image.size = image.width * image.height * image.components;
+        image.decoded_data = (unsigned char*) malloc(image.size);
+        for (unsigned int i = 0, seed = 1; i < image.size; ++i) {
+            seed = seed * 1103515245 + 12345;
+            image.decoded_data[i] = (seed >> 16) & 0xFF;
+        }
+    }
+
+    bool is_exact = verify_mip_generator(image, TRUE) && verify_mip_generator(image, FALSE);
+    deallocate_image(image);
+
+    return is_exact;
+}
+
 #endif // _TEXTURE_H_
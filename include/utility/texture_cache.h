@@ -0,0 +1,230 @@
+#ifndef _TEXTURE_CACHE_H_
+#define _TEXTURE_CACHE_H_
+
+#include <sys/stat.h>
+#include "./types.h"
+#include "./utils.h"
+#include "./parser.h"
+#include "./texture_compression.h"
+#include "./mipmap.h"
+#include "./profiler.h"
+
+// Decoded textures with their whole mip chain, stored next to the source image, either raw or block compressed.
+// Every level starts at TEXTURE_CACHE_ALIGNMENT, so each one can be uploaded straight out of the mapped file.
+// The type and the compression setting are part of the file name (e.g. "wall.png.normal.bc.texcache"), so an image used
+// with several types, or loaded with and without --compress-textures, keeps one cache for each.
+#define TEXTURE_CACHE_EXTENSION ".texcache"
+#define TEXTURE_CACHE_MAGIC 0x58455443 // "CTEX"
+#define TEXTURE_CACHE_VERSION 3
+#define TEXTURE_CACHE_ALIGNMENT 64
+#define TEXTURE_CACHE_MAX_LEVELS 32
+#define ALIGN_TEXTURE_CACHE_OFFSET(offset) (((offset) + TEXTURE_CACHE_ALIGNMENT - 1) & ~((unsigned long long int) TEXTURE_CACHE_ALIGNMENT - 1))
+
+typedef struct TextureCacheLevel {
+    unsigned int width;
+    unsigned int height;
+    unsigned long long int offset;
+    unsigned long long int size;
+} TextureCacheLevel;
+
+// The size and the mtime of the source image invalidate the cache, as do a different compression setting or texture type,
+// since the type decides both the filtering (sRGB or linear) and the format.
+// The format stays raw when compression was requested for one or two components images
+typedef struct TextureCacheHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long int source_size;
+    unsigned long long int source_mtime;
+    unsigned int is_compressed;
+    unsigned int type;
+    unsigned int format;
+    unsigned int components;
+    unsigned int levels_count;
+    TextureCacheLevel levels[TEXTURE_CACHE_MAX_LEVELS];
+    unsigned long long int file_size;
+} TextureCacheHeader;
+
+// Read-only view of a cache file, either mapped or just built in memory
+typedef struct TextureCache {
+    void* data;
+    size_t size;
+    bool is_mapped;
+    TextureCacheHeader* header;
+} TextureCache;
+
+/* DECLARATIONS */
+
+char* get_texture_cache_path(const char* source_path, TextureType type, bool compress);
+unsigned int get_mip_levels_count(unsigned int width, unsigned int height);
+const unsigned char* get_texture_cache_level(TextureCache* cache, unsigned int level);
+TextureCache* open_texture_cache(const char* source_path, TextureType type, bool compress);
+TextureCache* build_texture_cache(const char* source_path, Image image, TextureType type, bool compress);
+void close_texture_cache(TextureCache* cache);
+
+/* ----------------------------------------------- */
+
+static const char* texture_cache_type_str[] = { "base_color", "metallic_roughness", "normal", "occlusion", "emissive" };
+
+char* get_texture_cache_path(const char* source_path, TextureType type, bool compress) {
+    size_t size = strlen(source_path) + strlen(texture_cache_type_str[type]) + sizeof(".bc" TEXTURE_CACHE_EXTENSION) + 1;
+    char* cache_path = (char*) calloc(size, sizeof(char));
+    snprintf(cache_path, size, "%s.%s%s" TEXTURE_CACHE_EXTENSION, source_path, texture_cache_type_str[type], compress ? ".bc" : "");
+    return cache_path;
+}
+
+// Levels down to 1x1, as glGenerateMipmap would build
+unsigned int get_mip_levels_count(unsigned int width, unsigned int height) {
+    unsigned int levels_count = 1;
+    unsigned int size = width > height ? width : height;
+    while (size > 1 && levels_count < TEXTURE_CACHE_MAX_LEVELS) {
+        size >>= 1;
+        levels_count++;
+    }
+    return levels_count;
+}
+
+const unsigned char* get_texture_cache_level(TextureCache* cache, unsigned int level) {
+    return (const unsigned char*) (cache -> data) + cache -> header -> levels[level].offset;
+}
+
+static bool get_source_stat(const char* source_path, unsigned long long int* source_size, unsigned long long int* source_mtime) {
+    struct stat source_stat;
+    if (stat(source_path, &source_stat)) return FALSE;
+    *source_size = source_stat.st_size;
+    *source_mtime = source_stat.st_mtime;
+    return TRUE;
+}
+
+// Returns NULL when the cache is missing, older than its source or built for another type or compression setting
+TextureCache* open_texture_cache(const char* source_path, TextureType type, bool compress) {
+    unsigned long long int source_size = 0;
+    unsigned long long int source_mtime = 0;
+    if (!get_source_stat(source_path, &source_size, &source_mtime)) return NULL;
+
+    // Every level is uploaded right away, so the whole file is prefetched
+    FileView file = {0};
+    char* cache_path = get_texture_cache_path(source_path, type, compress);
+    bool is_mapped = map_file(cache_path, FILE_ACCESS_PREFETCH, &file);
+    free(cache_path);
+    if (!is_mapped) return NULL;
+
+    if (file.size < sizeof(TextureCacheHeader)) {
+        unmap_file(&file);
+        return NULL;
+    }
+
+    TextureCacheHeader* header = (TextureCacheHeader*) file.data;
+    bool is_valid = header -> magic == TEXTURE_CACHE_MAGIC && header -> version == TEXTURE_CACHE_VERSION;
+    is_valid = is_valid && header -> file_size == file.size && header -> levels_count <= TEXTURE_CACHE_MAX_LEVELS;
+    is_valid = is_valid && header -> source_size == source_size && header -> source_mtime == source_mtime && header -> is_compressed == compress;
+    is_valid = is_valid && header -> type == type;
+    if (!is_valid) {
+        debug_info("texture cache for '%s' is stale, rebuilding it\n", source_path);
+        unmap_file(&file);
+        return NULL;
+    }
+
+    // Each level is read at its offset, for the size its format needs, so all of them must lie inside the file
+    bool is_consistent = header -> levels_count >= 1 && header -> components >= 1 && header -> components <= 4 && header -> format <= TEXTURE_FORMAT_BC5;
+    for (unsigned int i = 0; is_consistent && i < header -> levels_count; ++i) {
+        TextureCacheLevel level = header -> levels[i];
+        is_consistent = level.offset <= file.size && level.size <= file.size - level.offset;
+        is_consistent = is_consistent && level.size >= get_texture_level_size(level.width, level.height, header -> components, header -> format);
+    }
+    if (!is_consistent) {
+        error_info("texture cache for '%s' is corrupted, rebuilding it\n", source_path);
+        unmap_file(&file);
+        return NULL;
+    }
+
+    TextureCache* cache = (TextureCache*) calloc(1, sizeof(TextureCache));
+    cache -> data = (void*) (file.data);
+    cache -> size = file.size;
+    cache -> is_mapped = TRUE;
+    cache -> header = header;
+
+    return cache;
+}
+
+// Lays out the mip chain of the decoded image in the file format, then writes it under a temporary name and renames it.
+// The chain is always filtered from the raw levels, in linear light for the color textures, compression only applies to the stored copy.
+// NOTE: a failed write is only reported, the returned cache lives in memory either way
+TextureCache* build_texture_cache(const char* source_path, Image image, TextureType type, bool compress) {
+    PROFILE_FUNCTION();
+    TextureCacheHeader header = {
+        .magic = TEXTURE_CACHE_MAGIC,
+        .version = TEXTURE_CACHE_VERSION,
+        .is_compressed = compress,
+        .type = type,
+        .format = compress ? select_texture_format(type, image) : TEXTURE_FORMAT_RAW,
+        .components = image.components,
+        .levels_count = get_mip_levels_count(image.width, image.height)
+    };
+    get_source_stat(source_path, &(header.source_size), &(header.source_mtime));
+
+    unsigned long long int offset = ALIGN_TEXTURE_CACHE_OFFSET(sizeof(TextureCacheHeader));
+    for (unsigned int i = 0, width = image.width, height = image.height; i < header.levels_count; ++i) {
+        header.levels[i] = (TextureCacheLevel) { .width = width, .height = height, .offset = offset, .size = get_texture_level_size(width, height, image.components, header.format) };
+        offset = ALIGN_TEXTURE_CACHE_OFFSET(offset + header.levels[i].size);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    header.file_size = header.levels[header.levels_count - 1].offset + header.levels[header.levels_count - 1].size;
+
+    unsigned char* data = (unsigned char*) calloc(header.file_size, sizeof(unsigned char));
+    memcpy(data, &header, sizeof(TextureCacheHeader));
+
+    bool is_srgb = type == BASE_COLOR_TEXTURE || type == EMISSIVE_TEXTURE;
+
+    // Two scratch levels are enough, each one is only read to filter the next
+    unsigned long long int scratch_size = header.levels_count > 1 ? (unsigned long long int) header.levels[1].width * header.levels[1].height * image.components : 0;
+    unsigned char* scratch[2] = { (unsigned char*) malloc(scratch_size), (unsigned char*) malloc(scratch_size) };
+    const unsigned char* texels = image.decoded_data;
+    for (unsigned int i = 0; i < header.levels_count; ++i) {
+        if (i > 0) {
+            generate_mip_level(texels, header.levels[i - 1].width, header.levels[i - 1].height, scratch[i & 1], image.components, is_srgb);
+            texels = scratch[i & 1];
+        }
+
+        if (header.format == TEXTURE_FORMAT_RAW) memcpy(data + header.levels[i].offset, texels, header.levels[i].size);
+        else compress_texture_level(texels, header.levels[i].width, header.levels[i].height, image.components, header.format, data + header.levels[i].offset);
+    }
+    free(scratch[0]);
+    free(scratch[1]);
+
+    TextureCache* cache = (TextureCache*) calloc(1, sizeof(TextureCache));
+    cache -> data = data;
+    cache -> size = header.file_size;
+    cache -> header = (TextureCacheHeader*) data;
+
+    char* cache_path = get_texture_cache_path(source_path, type, compress);
+    char* temp_path = (char*) calloc(strlen(cache_path) + 5, sizeof(char));
+    sprintf(temp_path, "%s.tmp", cache_path);
+
+    FILE* file = fopen(temp_path, "wb");
+    bool is_written = file != NULL;
+    if (is_written) {
+        is_written = fwrite(data, 1, header.file_size, file) == header.file_size;
+        is_written = (fclose(file) == 0) && is_written;
+    }
+
+    if (is_written) is_written = rename(temp_path, cache_path) == 0;
+    else remove(temp_path);
+
+    if (!is_written) error_info("failed to write the texture cache '%s'\n", cache_path);
+
+    free(temp_path);
+    free(cache_path);
+
+    return cache;
+}
+
+void close_texture_cache(TextureCache* cache) {
+    if (cache == NULL) return;
+    if (cache -> is_mapped) unmap_file(&(FileView) { .data = cache -> data, .size = cache -> size });
+    else free(cache -> data);
+    free(cache);
+    return;
+}
+
+#endif //_TEXTURE_CACHE_H_
@@ -0,0 +1,360 @@
+#ifndef _TEXTURE_COMPRESSION_H_
+#define _TEXTURE_COMPRESSION_H_
+
+#include "./types.h"
+#include "./utils.h"
+#include "./simd.h"
+#include "./thread_pool.h"
+
+// Block compression of 8 bit images: BC1 for opaque color, BC3 for color with alpha and BC5 for the two channels of normal maps.
+// The endpoints are the (inset) bounding box of each 4x4 block and every texel is projected on the axis between them,
+// all in integer math so the SIMD and scalar paths produce the same blocks.
+
+// Rows of blocks compressed by each job when a level is split over the worker pool
+#define BLOCK_ROWS_PER_JOB 16
+
+typedef enum TextureFormat { TEXTURE_FORMAT_RAW, TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC3, TEXTURE_FORMAT_BC5 } TextureFormat;
+
+const char* texture_format_str[] = { "RAW", "BC1", "BC3", "BC5" };
+static const unsigned char texture_format_block_sizes[] = { 0, 8, 16, 16 };
+
+// Band of block rows of a level
+typedef struct CompressionJob {
+    const unsigned char* src;
+    unsigned int width;
+    unsigned int height;
+    unsigned int components;
+    TextureFormat format;
+    unsigned char* dest;
+    unsigned int first_row;
+    unsigned int rows_count;
+} CompressionJob;
+
+/* DECLARATIONS */
+
+TextureFormat select_texture_format(TextureType type, Image image);
+unsigned long long int get_texture_level_size(unsigned int width, unsigned int height, unsigned int components, TextureFormat format);
+void compress_bc1_block(const unsigned char* block, unsigned char* dest);
+void compress_bc4_block(const unsigned char* block, unsigned int channel, unsigned char* dest);
+void compress_texture_level(const unsigned char* src, unsigned int width, unsigned int height, unsigned int components, TextureFormat format, unsigned char* dest);
+void decompress_bc1_block(const unsigned char* src, unsigned char* block);
+void decompress_bc4_block(const unsigned char* src, unsigned int channel, unsigned char* block);
+double get_compression_psnr(const unsigned char* src, unsigned int width, unsigned int height, unsigned int components, TextureFormat format, const unsigned char* compressed);
+
+/* ----------------------------------------------- */
+
+// Images with less than three components stay uncompressed, as their channels are sampled as red only
+TextureFormat select_texture_format(TextureType type, Image image) {
+    if (image.components < 3) return TEXTURE_FORMAT_RAW;
+    if (type == NORMAL_TEXTURE) return TEXTURE_FORMAT_BC5;
+    if (image.components == 3 || type != BASE_COLOR_TEXTURE) return TEXTURE_FORMAT_BC1;
+
+    for (unsigned int i = 3; i < image.size; i += 4) {
+        if (image.decoded_data[i] != 255) return TEXTURE_FORMAT_BC3;
+    }
+
+    return TEXTURE_FORMAT_BC1;
+}
+
+unsigned long long int get_texture_level_size(unsigned int width, unsigned int height, unsigned int components, TextureFormat format) {
+    if (format == TEXTURE_FORMAT_RAW) return (unsigned long long int) width * height * components;
+    return (unsigned long long int) ((width + 3) / 4) * ((height + 3) / 4) * texture_format_block_sizes[format];
+}
+
+// The texels past the border of the level repeat the last row and column, missing components are opaque
+static void fetch_block(const unsigned char* src, unsigned int width, unsigned int height, unsigned int components, unsigned int block_x, unsigned int block_y, unsigned char* block) {
+    for (unsigned int y = 0; y < 4; ++y) {
+        unsigned int src_y = block_y * 4 + y < height ? block_y * 4 + y : height - 1;
+        for (unsigned int x = 0; x < 4; ++x) {
+            unsigned int src_x = block_x * 4 + x < width ? block_x * 4 + x : width - 1;
+            const unsigned char* texel = src + ((unsigned long long int) src_y * width + src_x) * components;
+            unsigned char* dest = block + (y * 4 + x) * 4;
+            dest[0] = texel[0];
+            dest[1] = texel[components > 1];
+            dest[2] = texel[components > 2 ? 2 : 0];
+            dest[3] = components > 3 ? texel[3] : 255;
+        }
+    }
+    return;
+}
+
+static void get_block_bounds(const unsigned char* block, unsigned char* min, unsigned char* max) {
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+    __m128i texels[4];
+    for (unsigned int i = 0; i < 4; ++i) texels[i] = _mm_loadu_si128((const __m128i*) (block + i * 16));
+    __m128i min_v = _mm_min_epu8(_mm_min_epu8(texels[0], texels[1]), _mm_min_epu8(texels[2], texels[3]));
+    __m128i max_v = _mm_max_epu8(_mm_max_epu8(texels[0], texels[1]), _mm_max_epu8(texels[2], texels[3]));
+    min_v = _mm_min_epu8(min_v, _mm_shuffle_epi32(min_v, _MM_SHUFFLE(1, 0, 3, 2)));
+    max_v = _mm_max_epu8(max_v, _mm_shuffle_epi32(max_v, _MM_SHUFFLE(1, 0, 3, 2)));
+    min_v = _mm_min_epu8(min_v, _mm_shuffle_epi32(min_v, _MM_SHUFFLE(2, 3, 0, 1)));
+    max_v = _mm_max_epu8(max_v, _mm_shuffle_epi32(max_v, _MM_SHUFFLE(2, 3, 0, 1)));
+    int min_texel = _mm_cvtsi128_si32(min_v);
+    int max_texel = _mm_cvtsi128_si32(max_v);
+    memcpy(min, &min_texel, 4);
+    memcpy(max, &max_texel, 4);
+#else
+    memcpy(min, block, 4);
+    memcpy(max, block, 4);
+    for (unsigned int i = 1; i < 16; ++i) {
+        for (unsigned int c = 0; c < 4; ++c) {
+            if (block[i * 4 + c] < min[c]) min[c] = block[i * 4 + c];
+            if (block[i * 4 + c] > max[c]) max[c] = block[i * 4 + c];
+        }
+    }
+#endif
+    return;
+}
+
+// Position of each texel between the endpoints in sixths of the axis, counted against the thresholds at 1/6, 3/6 and 5/6
+static void get_bc1_steps(const unsigned char* block, const int* axis, int origin, int range, int* steps) {
+    unsigned int i = 0;
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+    __m128i zero = _mm_setzero_si128();
+    __m128i axis_v = _mm_setr_epi16(axis[0], axis[1], axis[2], 0, axis[0], axis[1], axis[2], 0);
+    __m128i origin_v = _mm_set1_epi32(origin);
+    __m128i thresholds[3] = { _mm_set1_epi32(range), _mm_set1_epi32(3 * range), _mm_set1_epi32(5 * range) };
+    for (; i < 16; i += 4) {
+        __m128i texels = _mm_loadu_si128((const __m128i*) (block + i * 4));
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(texels, zero), axis_v);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(texels, zero), axis_v);
+        __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+        __m128i distance = _mm_sub_epi32(_mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd)), origin_v);
+        distance = _mm_add_epi32(_mm_slli_epi32(distance, 2), _mm_slli_epi32(distance, 1));
+        __m128i step = _mm_setzero_si128();
+        for (unsigned int j = 0; j < 3; ++j) step = _mm_sub_epi32(step, _mm_cmpgt_epi32(distance, thresholds[j]));
+        _mm_storeu_si128((__m128i*) (steps + i), step);
+    }
+#endif
+    for (; i < 16; ++i) {
+        const unsigned char* texel = block + i * 4;
+        int distance = (texel[0] * axis[0] + texel[1] * axis[1] + texel[2] * axis[2] - origin) * 6;
+        steps[i] = (distance > range) + (distance > 3 * range) + (distance > 5 * range);
+    }
+    return;
+}
+
+// Nearest of the eight interpolated values, counted against the midpoints (2k - 1) / 14 of the range
+static void get_bc4_steps(const unsigned char* values, int min, int range, short int* steps) {
+    unsigned int i = 0;
+#if defined(_SIMD_X86_) && defined(__SSE2__)
+    __m128i min_v = _mm_set1_epi16(min);
+    __m128i fourteen = _mm_set1_epi16(14);
+    for (; i < 16; i += 8) {
+        __m128i distance = _mm_mullo_epi16(_mm_sub_epi16(_mm_setr_epi16(values[i * 4], values[(i + 1) * 4], values[(i + 2) * 4], values[(i + 3) * 4], values[(i + 4) * 4], values[(i + 5) * 4], values[(i + 6) * 4], values[(i + 7) * 4]), min_v), fourteen);
+        __m128i step = _mm_setzero_si128();
+        for (int k = 1; k < 8; ++k) step = _mm_sub_epi16(step, _mm_cmpgt_epi16(distance, _mm_set1_epi16((2 * k - 1) * range - 1)));
+        _mm_storeu_si128((__m128i*) (steps + i), step);
+    }
+#endif
+    for (; i < 16; ++i) {
+        int distance = (values[i * 4] - min) * 14;
+        steps[i] = 0;
+        for (int k = 1; k < 8; ++k) steps[i] += distance >= (2 * k - 1) * range;
+    }
+    return;
+}
+
+static unsigned short int pack_565(const unsigned char* color) {
+    return (((color[0] * 31 + 127) / 255) << 11) | (((color[1] * 63 + 127) / 255) << 5) | ((color[2] * 31 + 127) / 255);
+}
+
+static void unpack_565(unsigned short int packed, int* color) {
+    color[0] = ((packed >> 11) << 3) | (packed >> 13);
+    color[1] = (((packed >> 5) & 0x3F) << 2) | ((packed >> 9) & 0x3);
+    color[2] = ((packed & 0x1F) << 3) | ((packed >> 2) & 0x7);
+    return;
+}
+
+// Always in the four color mode, since the same block is also the color half of BC3
+void compress_bc1_block(const unsigned char* block, unsigned char* dest) {
+    static const unsigned char step_indices[] = { 1, 3, 2, 0 };
+
+    unsigned char min[4] = {0};
+    unsigned char max[4] = {0};
+    get_block_bounds(block, min, max);
+
+    // Pull the endpoints in by 1/16 of the range, the extremes are rarely worth an endpoint
+    for (unsigned int c = 0; c < 3; ++c) {
+        unsigned char inset = (max[c] - min[c]) >> 4;
+        min[c] += inset;
+        max[c] -= inset;
+    }
+
+    unsigned short int color0 = pack_565(max);
+    unsigned short int color1 = pack_565(min);
+    int endpoint0[3] = {0};
+    int endpoint1[3] = {0};
+    unpack_565(color0, endpoint0);
+    unpack_565(color1, endpoint1);
+
+    int axis[3] = { endpoint0[0] - endpoint1[0], endpoint0[1] - endpoint1[1], endpoint0[2] - endpoint1[2] };
+    int origin = endpoint1[0] * axis[0] + endpoint1[1] * axis[1] + endpoint1[2] * axis[2];
+    int range = endpoint0[0] * axis[0] + endpoint0[1] * axis[1] + endpoint0[2] * axis[2] - origin;
+
+    int steps[16] = {0};
+    get_bc1_steps(block, axis, origin, range, steps);
+
+    unsigned int indices = 0;
+    for (unsigned int i = 0; i < 16; ++i) indices |= (unsigned int) step_indices[steps[i]] << (2 * i);
+
+    dest[0] = color0 & 0xFF;
+    dest[1] = color0 >> 8;
+    dest[2] = color1 & 0xFF;
+    dest[3] = color1 >> 8;
+    for (unsigned int i = 0; i < 4; ++i) dest[4 + i] = (indices >> (8 * i)) & 0xFF;
+
+    return;
+}
+
+// Single channel of the RGBA block, in the eight values mode
+void compress_bc4_block(const unsigned char* block, unsigned int channel, unsigned char* dest) {
+    static const unsigned char step_indices[] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+
+    int min = block[channel];
+    int max = block[channel];
+    for (unsigned int i = 1; i < 16; ++i) {
+        if (block[i * 4 + channel] < min) min = block[i * 4 + channel];
+        if (block[i * 4 + channel] > max) max = block[i * 4 + channel];
+    }
+
+    short int steps[16] = {0};
+    if (max > min) get_bc4_steps(block + channel, min, max - min, steps);
+    else for (unsigned int i = 0; i < 16; ++i) steps[i] = 7;
+
+    unsigned long long int indices = 0;
+    for (unsigned int i = 0; i < 16; ++i) indices |= (unsigned long long int) step_indices[steps[i]] << (3 * i);
+
+    dest[0] = max;
+    dest[1] = min;
+    for (unsigned int i = 0; i < 6; ++i) dest[2 + i] = (indices >> (8 * i)) & 0xFF;
+
+    return;
+}
+
+static void compress_block_rows(CompressionJob* job) {
+    unsigned int blocks_per_row = (job -> width + 3) / 4;
+    unsigned char block_size = texture_format_block_sizes[job -> format];
+    unsigned char block[64];
+
+    for (unsigned int block_y = job -> first_row; block_y < job -> first_row + job -> rows_count; ++block_y) {
+        for (unsigned int block_x = 0; block_x < blocks_per_row; ++block_x) {
+            unsigned char* dest = job -> dest + ((unsigned long long int) block_y * blocks_per_row + block_x) * block_size;
+            fetch_block(job -> src, job -> width, job -> height, job -> components, block_x, block_y, block);
+            if (job -> format == TEXTURE_FORMAT_BC1) {
+                compress_bc1_block(block, dest);
+            } else if (job -> format == TEXTURE_FORMAT_BC3) {
+                compress_bc4_block(block, 3, dest);
+                compress_bc1_block(block, dest + 8);
+            } else if (job -> format == TEXTURE_FORMAT_BC5) {
+                compress_bc4_block(block, 0, dest);
+                compress_bc4_block(block, 1, dest + 8);
+            }
+        }
+    }
+
+    return;
+}
+
+static void compress_block_rows_job(void* args) {
+    compress_block_rows((CompressionJob*) args);
+    return;
+}
+
+// Large levels are split in bands of block rows over the worker pool, the calling thread compresses too while it waits
+void compress_texture_level(const unsigned char* src, unsigned int width, unsigned int height, unsigned int components, TextureFormat format, unsigned char* dest) {
+    unsigned int block_rows = (height + 3) / 4;
+    unsigned int jobs_count = (block_rows + BLOCK_ROWS_PER_JOB - 1) / BLOCK_ROWS_PER_JOB;
+
+    CompressionJob* jobs = (CompressionJob*) calloc(jobs_count, sizeof(CompressionJob));
+    JobGroup group = {0};
+    for (unsigned int i = 0; i < jobs_count; ++i) {
+        unsigned int first_row = i * BLOCK_ROWS_PER_JOB;
+        jobs[i] = (CompressionJob) {
+            .src = src, .width = width, .height = height, .components = components, .format = format, .dest = dest,
+            .first_row = first_row, .rows_count = (block_rows - first_row) < BLOCK_ROWS_PER_JOB ? (block_rows - first_row) : BLOCK_ROWS_PER_JOB
+        };
+    }
+
+    if (jobs_count == 1) compress_block_rows(jobs);
+    else {
+        for (unsigned int i = 0; i < jobs_count; ++i) submit_group_job(get_worker_pool(), &group, compress_block_rows_job, jobs + i);
+        help_group(get_worker_pool(), &group);
+    }
+
+    free(jobs);
+
+    return;
+}
+
+void decompress_bc1_block(const unsigned char* src, unsigned char* block) {
+    int palette[4][3] = {0};
+    unpack_565(src[0] | (src[1] << 8), palette[0]);
+    unpack_565(src[2] | (src[3] << 8), palette[1]);
+    for (unsigned int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    unsigned int indices = src[4] | (src[5] << 8) | (src[6] << 16) | ((unsigned int) src[7] << 24);
+    for (unsigned int i = 0; i < 16; ++i) {
+        unsigned int index = (indices >> (2 * i)) & 0x3;
+        for (unsigned int c = 0; c < 3; ++c) block[i * 4 + c] = palette[index][c];
+        block[i * 4 + 3] = 255;
+    }
+
+    return;
+}
+
+void decompress_bc4_block(const unsigned char* src, unsigned int channel, unsigned char* block) {
+    int palette[8] = { src[0], src[1] };
+    for (int i = 1; i < 7; ++i) {
+        palette[i + 1] = src[0] > src[1] ? ((7 - i) * src[0] + i * src[1]) / 7 : (i < 5 ? ((5 - i) * src[0] + i * src[1]) / 5 : (i == 5 ? 0 : 255));
+    }
+
+    unsigned long long int indices = 0;
+    for (unsigned int i = 0; i < 6; ++i) indices |= (unsigned long long int) src[2 + i] << (8 * i);
+    for (unsigned int i = 0; i < 16; ++i) block[i * 4 + channel] = palette[(indices >> (3 * i)) & 0x7];
+
+    return;
+}
+
+// Peak signal to noise ratio over the channels the format keeps
+double get_compression_psnr(const unsigned char* src, unsigned int width, unsigned int height, unsigned int components, TextureFormat format, const unsigned char* compressed) {
+    unsigned int channels = format == TEXTURE_FORMAT_BC3 ? 4 : (format == TEXTURE_FORMAT_BC5 ? 2 : 3);
+    unsigned int blocks_per_row = (width + 3) / 4;
+    unsigned char block_size = texture_format_block_sizes[format];
+    unsigned char original[64];
+    unsigned char decoded[64];
+
+    double squared_error = 0.0;
+    unsigned long long int samples = 0;
+    for (unsigned int block_y = 0; block_y < (height + 3) / 4; ++block_y) {
+        for (unsigned int block_x = 0; block_x < blocks_per_row; ++block_x) {
+            const unsigned char* block = compressed + ((unsigned long long int) block_y * blocks_per_row + block_x) * block_size;
+            fetch_block(src, width, height, components, block_x, block_y, original);
+            if (format == TEXTURE_FORMAT_BC1) decompress_bc1_block(block, decoded);
+            else if (format == TEXTURE_FORMAT_BC3) {
+                decompress_bc1_block(block + 8, decoded);
+                decompress_bc4_block(block, 3, decoded);
+            } else {
+                decompress_bc4_block(block, 0, decoded);
+                decompress_bc4_block(block + 8, 1, decoded);
+            }
+
+            for (unsigned int i = 0; i < 16; ++i) {
+                if (block_x * 4 + i % 4 >= width || block_y * 4 + i / 4 >= height) continue;
+                for (unsigned int c = 0; c < channels; ++c) {
+                    double error = (double) original[i * 4 + c] - decoded[i * 4 + c];
+                    squared_error += error * error;
+                }
+                samples += channels;
+            }
+        }
+    }
+
+    if (squared_error == 0.0) return 99.0;
+    return 10.0 * log10((255.0 * 255.0) / (squared_error / samples));
+}
+
+#endif //_TEXTURE_COMPRESSION_H_
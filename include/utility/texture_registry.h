@@ -0,0 +1,171 @@
+#ifndef _TEXTURE_REGISTRY_H_
+#define _TEXTURE_REGISTRY_H_
+
+#include "./utils.h"
+#include "./parser.h"
+#include "./hash_map.h"
+#include "./texture.h"
+
+// Texture shared by every model referencing the same path or the same encoded file with the same type and params.
+// The type decides the format, the compression and the mip filtering, so the same image used as base color and as
+// normal map is two textures
+typedef struct TextureEntry {
+    unsigned int id;
+    char* path;
+    TextureType type;
+    TextureParams texture_params;
+    unsigned long long int content_hash;
+    unsigned long long int vram_size;
+    unsigned int references;
+} TextureEntry;
+
+// Both maps hold indices in the entries, keyed by the path or the content hash mixed with the type and the params.
+// The content hash is 0 when the file could not be read
+typedef struct TextureRegistry {
+    Array entries;
+    HashMap paths;
+    HashMap contents;
+    unsigned int decodes_count;
+    unsigned int path_hits;
+    unsigned int content_hits;
+} TextureRegistry;
+
+/* DECLARATIONS */
+
+unsigned long long int hash_file(const char* file_path);
+unsigned long long int get_texture_usage_seed(TextureType type, TextureParams texture_params);
+TextureRegistry* get_texture_registry(void);
+TextureEntry* acquire_texture(char* path, unsigned long long int content_hash, TextureType type, TextureParams texture_params, const unsigned char* placeholder_texel, TextureQueue* texture_queue);
+void release_texture(TextureEntry* entry);
+void print_texture_registry_stats(void);
+void deallocate_texture_registry(void);
+
+/* ----------------------------------------------- */
+
+static TextureRegistry* texture_registry = NULL;
+
+// FNV-1a over the encoded file, returns 0 when it cannot be read
+unsigned long long int hash_file(const char* file_path) {
+    FileView file = {0};
+    if (!map_file(file_path, FILE_ACCESS_SEQUENTIAL, &file)) return 0;
+
+    unsigned long long int hash = file.size ? fnv1a_hash(file.data, file.size, FNV1A_OFFSET_BASIS) : 0;
+    unmap_file(&file);
+
+    return hash;
+}
+
+// Seed of the hashes keying a texture, so each type and params of the same image gets its own key
+unsigned long long int get_texture_usage_seed(TextureType type, TextureParams texture_params) {
+    unsigned int type_value = type;
+    unsigned long long int seed = fnv1a_hash(&type_value, sizeof(type_value), FNV1A_OFFSET_BASIS);
+    return fnv1a_hash(&texture_params, sizeof(TextureParams), seed);
+}
+
+static bool is_same_usage(TextureEntry* entry, TextureType type, TextureParams texture_params) {
+    return entry -> type == type && !memcmp(&(entry -> texture_params), &texture_params, sizeof(TextureParams));
+}
+
+TextureRegistry* get_texture_registry(void) {
+    if (texture_registry == NULL) {
+        texture_registry = (TextureRegistry*) calloc(1, sizeof(TextureRegistry));
+        texture_registry -> entries = init_arr();
+    }
+    return texture_registry;
+}
+
+// Looks the texture up by path, then by content, and only queues a decode when neither is loaded.
+// Every call takes a reference that must be given back with release_texture
+TextureEntry* acquire_texture(char* path, unsigned long long int content_hash, TextureType type, TextureParams texture_params, const unsigned char* placeholder_texel, TextureQueue* texture_queue) {
+    TextureRegistry* registry = get_texture_registry();
+    unsigned long long int usage_seed = get_texture_usage_seed(type, texture_params);
+    unsigned long long int path_hash = fnv1a_hash(path, strlen(path), usage_seed);
+    unsigned long long int content_key = content_hash ? fnv1a_hash(&content_hash, sizeof(content_hash), usage_seed) : 0;
+    unsigned long long int index = 0;
+
+    TextureEntry* entry = NULL;
+    bool is_path_hit = FALSE;
+    if (hash_map_get(&(registry -> paths), path_hash, &index)) {
+        entry = GET_ELEMENT(TextureEntry*, registry -> entries, index);
+        is_path_hit = !strcmp(entry -> path, path) && is_same_usage(entry, type, texture_params);
+        if (!is_path_hit) entry = NULL;
+    }
+
+    // Same file under another name, the path becomes an alias of the entry
+    if (entry == NULL && content_key && hash_map_get(&(registry -> contents), content_key, &index)) {
+        entry = GET_ELEMENT(TextureEntry*, registry -> entries, index);
+        if (is_same_usage(entry, type, texture_params)) hash_map_put(&(registry -> paths), path_hash, index);
+        else entry = NULL;
+    }
+
+    if (entry != NULL && entry -> references) {
+        if (is_path_hit) (registry -> path_hits)++;
+        else (registry -> content_hits)++;
+        (entry -> references)++;
+        return entry;
+    }
+
+    if (entry == NULL) {
+        entry = (TextureEntry*) calloc(1, sizeof(TextureEntry));
+        entry -> path = (char*) calloc(strlen(path) + 1, sizeof(char));
+        strcpy(entry -> path, path);
+        entry -> type = type;
+        entry -> texture_params = texture_params;
+        entry -> content_hash = content_hash;
+        hash_map_put(&(registry -> paths), path_hash, registry -> entries.count);
+        if (content_key) hash_map_put(&(registry -> contents), content_key, registry -> entries.count);
+        append_element(&(registry -> entries), entry);
+    }
+
+    // New or released entries are decoded again
+    queue_texture(texture_queue, entry -> path, type, &(entry -> id), texture_params, &(entry -> vram_size));
+    upload_placeholder_texture(entry -> id, placeholder_texel);
+    (registry -> decodes_count)++;
+    entry -> references = 1;
+
+    return entry;
+}
+
+// The GL texture is deleted with the last reference, the entry is kept so a later load finds it again
+void release_texture(TextureEntry* entry) {
+    if (entry == NULL || entry -> references == 0) return;
+    if (--(entry -> references) == 0) {
+        glDeleteTextures(1, &(entry -> id));
+        entry -> id = 0;
+        entry -> vram_size = 0;
+    }
+    return;
+}
+
+// Every reference past the first one is a decode and a copy in VRAM that were not needed
+void print_texture_registry_stats(void) {
+    TextureRegistry* registry = get_texture_registry();
+
+    unsigned long long int vram_saved = 0;
+    for (unsigned int i = 0; i < registry -> entries.count; ++i) {
+        TextureEntry* entry = GET_ELEMENT(TextureEntry*, registry -> entries, i);
+        if (entry -> references > 1) vram_saved += (entry -> references - 1) * entry -> vram_size;
+    }
+
+    debug_info("textures: %u decodes, %u saved by path and %u by content, %.2f MB of VRAM saved\n", registry -> decodes_count, registry -> path_hits, registry -> content_hits, vram_saved / (1024.0 * 1024.0));
+
+    return;
+}
+
+// NOTE: the GL textures are owned by the models, they must have been released already
+void deallocate_texture_registry(void) {
+    if (texture_registry == NULL) return;
+    for (unsigned int i = 0; i < texture_registry -> entries.count; ++i) {
+        TextureEntry* entry = GET_ELEMENT(TextureEntry*, texture_registry -> entries, i);
+        free(entry -> path);
+        free(entry);
+    }
+    deallocate_arr(texture_registry -> entries);
+    deallocate_hash_map(&(texture_registry -> paths));
+    deallocate_hash_map(&(texture_registry -> contents));
+    free(texture_registry);
+    texture_registry = NULL;
+    return;
+}
+
+#endif //_TEXTURE_REGISTRY_H_
@@ -0,0 +1,212 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <pthread.h>
+#include <unistd.h>
+#include "./utils.h"
+
+// Minimum capacity of the jobs queue, it doubles whenever it fills up
+#define JOBS_QUEUE_SIZE 64
+
+typedef void (*JobFunction)(void* args);
+
+// Jobs submitted together that can be waited on without waiting for the rest of the queue
+typedef struct JobGroup {
+    unsigned int pending_jobs;
+} JobGroup;
+
+typedef struct Job {
+    JobFunction function;
+    void* args;
+    JobGroup* group;
+} Job;
+
+// Fixed set of worker threads consuming a FIFO queue of jobs
+typedef struct ThreadPool {
+    pthread_t* threads;
+    unsigned int threads_count;
+    Job* jobs;
+    unsigned int jobs_capacity;
+    unsigned int jobs_head;
+    unsigned int jobs_count;
+    unsigned int pending_jobs;
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t job_available;
+    pthread_cond_t jobs_done;
+} ThreadPool;
+
+/* DECLARATIONS */
+
+unsigned int get_cores_count(void);
+ThreadPool* init_thread_pool(unsigned int threads_count);
+void submit_job(ThreadPool* pool, JobFunction function, void* args);
+void submit_group_job(ThreadPool* pool, JobGroup* group, JobFunction function, void* args);
+void wait_jobs(ThreadPool* pool);
+void wait_group(ThreadPool* pool, JobGroup* group);
+void help_group(ThreadPool* pool, JobGroup* group);
+void deallocate_thread_pool(ThreadPool* pool);
+ThreadPool* get_worker_pool(void);
+void deallocate_worker_pool(void);
+
+/* ----------------------------------------------- */
+
+static ThreadPool* worker_pool = NULL;
+
+unsigned int get_cores_count(void) {
+    long int cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores < 1 ? 1 : (unsigned int) cores;
+}
+
+// NOTE: expects the lock held and a queued job, the lock is released while the job runs
+static void run_next_job(ThreadPool* pool) {
+    Job job = pool -> jobs[pool -> jobs_head];
+    pool -> jobs_head = (pool -> jobs_head + 1) % pool -> jobs_capacity;
+    (pool -> jobs_count)--;
+
+    pthread_mutex_unlock(&(pool -> lock));
+    job.function(job.args);
+    pthread_mutex_lock(&(pool -> lock));
+
+    if (job.group != NULL) --(job.group -> pending_jobs);
+    if (--(pool -> pending_jobs) == 0 || (job.group != NULL && job.group -> pending_jobs == 0)) pthread_cond_broadcast(&(pool -> jobs_done));
+
+    return;
+}
+
+static void* worker_loop(void* args) {
+    ThreadPool* pool = (ThreadPool*) args;
+
+    pthread_mutex_lock(&(pool -> lock));
+    while (TRUE) {
+        while (pool -> jobs_count == 0 && !(pool -> stop)) pthread_cond_wait(&(pool -> job_available), &(pool -> lock));
+        if (pool -> jobs_count == 0) break;
+        run_next_job(pool);
+    }
+    pthread_mutex_unlock(&(pool -> lock));
+
+    return NULL;
+}
+
+ThreadPool* init_thread_pool(unsigned int threads_count) {
+    ThreadPool* pool = (ThreadPool*) calloc(1, sizeof(ThreadPool));
+    pool -> jobs_capacity = JOBS_QUEUE_SIZE;
+    pool -> jobs = (Job*) calloc(pool -> jobs_capacity, sizeof(Job));
+    pool -> threads = (pthread_t*) calloc(threads_count, sizeof(pthread_t));
+    pthread_mutex_init(&(pool -> lock), NULL);
+    pthread_cond_init(&(pool -> job_available), NULL);
+    pthread_cond_init(&(pool -> jobs_done), NULL);
+
+    for (unsigned int i = 0; i < threads_count; ++i, ++(pool -> threads_count)) {
+        if (pthread_create(pool -> threads + i, NULL, worker_loop, pool)) {
+            error_info("failed to create worker thread %u, continuing with %u workers.\n", i, i);
+            break;
+        }
+    }
+
+    return pool;
+}
+
+void submit_job(ThreadPool* pool, JobFunction function, void* args) {
+    submit_group_job(pool, NULL, function, args);
+    return;
+}
+
+// NOTE: without workers the job runs right away on the calling thread
+void submit_group_job(ThreadPool* pool, JobGroup* group, JobFunction function, void* args) {
+    if (pool -> threads_count == 0) {
+        function(args);
+        return;
+    }
+
+    pthread_mutex_lock(&(pool -> lock));
+
+    if (pool -> jobs_count == pool -> jobs_capacity) {
+        // Unroll the ring into the grown queue
+        Job* jobs = (Job*) calloc(pool -> jobs_capacity * 2, sizeof(Job));
+        for (unsigned int i = 0; i < pool -> jobs_count; ++i) {
+            jobs[i] = pool -> jobs[(pool -> jobs_head + i) % pool -> jobs_capacity];
+        }
+        free(pool -> jobs);
+        pool -> jobs = jobs;
+        pool -> jobs_head = 0;
+        pool -> jobs_capacity *= 2;
+    }
+
+    pool -> jobs[(pool -> jobs_head + pool -> jobs_count) % pool -> jobs_capacity] = (Job) { .function = function, .args = args, .group = group };
+    (pool -> jobs_count)++;
+    (pool -> pending_jobs)++;
+    if (group != NULL) (group -> pending_jobs)++;
+
+    pthread_cond_signal(&(pool -> job_available));
+    pthread_mutex_unlock(&(pool -> lock));
+
+    return;
+}
+
+// Blocks until every submitted job has completed
+void wait_jobs(ThreadPool* pool) {
+    pthread_mutex_lock(&(pool -> lock));
+    while (pool -> pending_jobs) pthread_cond_wait(&(pool -> jobs_done), &(pool -> lock));
+    pthread_mutex_unlock(&(pool -> lock));
+    return;
+}
+
+// Blocks until every job of the group has completed
+void wait_group(ThreadPool* pool, JobGroup* group) {
+    pthread_mutex_lock(&(pool -> lock));
+    while (group -> pending_jobs) pthread_cond_wait(&(pool -> jobs_done), &(pool -> lock));
+    pthread_mutex_unlock(&(pool -> lock));
+    return;
+}
+
+// Like wait_group, but the calling thread runs the queued jobs meanwhile.
+// NOTE: a job splitting its work over the pool must wait with this, otherwise every worker could end up waiting
+void help_group(ThreadPool* pool, JobGroup* group) {
+    pthread_mutex_lock(&(pool -> lock));
+    while (group -> pending_jobs) {
+        if (pool -> jobs_count) run_next_job(pool);
+        else pthread_cond_wait(&(pool -> jobs_done), &(pool -> lock));
+    }
+    pthread_mutex_unlock(&(pool -> lock));
+    return;
+}
+
+// The queued jobs are drained before the workers exit
+void deallocate_thread_pool(ThreadPool* pool) {
+    pthread_mutex_lock(&(pool -> lock));
+    pool -> stop = TRUE;
+    pthread_cond_broadcast(&(pool -> job_available));
+    pthread_mutex_unlock(&(pool -> lock));
+
+    for (unsigned int i = 0; i < pool -> threads_count; ++i) {
+        pthread_join(pool -> threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&(pool -> lock));
+    pthread_cond_destroy(&(pool -> job_available));
+    pthread_cond_destroy(&(pool -> jobs_done));
+    free(pool -> threads);
+    free(pool -> jobs);
+    free(pool);
+
+    return;
+}
+
+// Shared pool with one worker per core, created on first use
+ThreadPool* get_worker_pool(void) {
+    if (worker_pool == NULL) {
+        worker_pool = init_thread_pool(get_cores_count());
+        debug_info("started %u worker threads\n", worker_pool -> threads_count);
+    }
+    return worker_pool;
+}
+
+void deallocate_worker_pool(void) {
+    if (worker_pool == NULL) return;
+    deallocate_thread_pool(worker_pool);
+    worker_pool = NULL;
+    return;
+}
+
+#endif //_THREAD_POOL_H_
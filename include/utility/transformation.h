@@ -4,202 +4,148 @@
 #include "./matrix.h"
 #include "./utils.h"
 
-void scale_matrix(Matrix scaling_mat, Vector scaling_vec, Matrix* dest) {
-    unsigned int vec_size = VEC_SIZE(scaling_vec);
-    assert(vec_size >= 3);
-
-    Matrix temp = alloc_matrix(0.0f, 1, 1);
-    copy_matrix(scaling_mat, &temp);
+/* FIXED-SIZE TRANSFORMATIONS */
 
-    for (unsigned int row = 0; row < scaling_mat.rows; ++row) {
-        for (unsigned int col = 0; col < scaling_mat.cols; ++col) {
-            MAT_INDEX(temp, row, col) = MAT_INDEX(scaling_mat, row, col) * ((vec_size == col) ? 1.0f : VEC_INDEX(scaling_vec, col));
+Mat4 mat4_scale(Mat4 mat, Vec3 scaling_vec) {
+    for (unsigned int row = 0; row < 4; ++row) {
+        for (unsigned int col = 0; col < 3; ++col) {
+            MAT4_INDEX(mat, row, col) *= VEC_INDEX(scaling_vec, col);
         }
     }
 
-    copy_matrix(temp, dest);
-    DEALLOCATE_MATRICES(temp);
-
-    return;
+    return mat;
 }
 
-void rotation_x_matrix(float angle, int size, Matrix* dest) {
-    Matrix rotation_x_mat = create_identity_matrix(size);
-
-    MAT_INDEX(rotation_x_mat, 1, 1) = cosf(deg_to_rad(angle));
-    MAT_INDEX(rotation_x_mat, 1, 2) = (-sinf(deg_to_rad(angle)));
-    MAT_INDEX(rotation_x_mat, 2, 1) = sinf(deg_to_rad(angle));
-    MAT_INDEX(rotation_x_mat, 2, 2) = cosf(deg_to_rad(angle));
+Mat4 mat4_rotation_x(float angle) {
+    Mat4 rotation_x_mat = mat4_identity();
 
-    // Copy the rotation_mat
-    copy_matrix(rotation_x_mat, dest);
+    MAT4_INDEX(rotation_x_mat, 1, 1) = cosf(deg_to_rad(angle));
+    MAT4_INDEX(rotation_x_mat, 1, 2) = (-sinf(deg_to_rad(angle)));
+    MAT4_INDEX(rotation_x_mat, 2, 1) = sinf(deg_to_rad(angle));
+    MAT4_INDEX(rotation_x_mat, 2, 2) = cosf(deg_to_rad(angle));
 
-    // Deallocate unused matrix
-    DEALLOCATE_MATRICES(rotation_x_mat);
-
-    return;
+    return rotation_x_mat;
 }
 
-void rotation_y_matrix(float angle, int size, Matrix* dest) {
-    Matrix rotation_y_mat = create_identity_matrix(size);
-
-    MAT_INDEX(rotation_y_mat, 0, 0) = cosf(deg_to_rad(angle));
-    MAT_INDEX(rotation_y_mat, 0, 2) = sinf(deg_to_rad(angle));
-    MAT_INDEX(rotation_y_mat, 2, 0) = (-sinf(deg_to_rad(angle)));
-    MAT_INDEX(rotation_y_mat, 2, 2) = cosf(deg_to_rad(angle));
-
-    // Copy the rotation_mat
-    copy_matrix(rotation_y_mat, dest);
+Mat4 mat4_rotation_y(float angle) {
+    Mat4 rotation_y_mat = mat4_identity();
 
-    // Deallocate unused matrix
-    DEALLOCATE_MATRICES(rotation_y_mat);
+    MAT4_INDEX(rotation_y_mat, 0, 0) = cosf(deg_to_rad(angle));
+    MAT4_INDEX(rotation_y_mat, 0, 2) = sinf(deg_to_rad(angle));
+    MAT4_INDEX(rotation_y_mat, 2, 0) = (-sinf(deg_to_rad(angle)));
+    MAT4_INDEX(rotation_y_mat, 2, 2) = cosf(deg_to_rad(angle));
 
-    return;
+    return rotation_y_mat;
 }
 
-void rotation_z_matrix(float angle, int size, Matrix* dest) {
-    Matrix rotation_z_mat = create_identity_matrix(size);
-
-    MAT_INDEX(rotation_z_mat, 0, 0) = cosf(deg_to_rad(angle));
-    MAT_INDEX(rotation_z_mat, 0, 1) = (-sinf(deg_to_rad(angle)));
-    MAT_INDEX(rotation_z_mat, 1, 0) = sinf(deg_to_rad(angle));
-    MAT_INDEX(rotation_z_mat, 1, 1) = cosf(deg_to_rad(angle));
-
-    // Copy the rotation_mat
-    copy_matrix(rotation_z_mat, dest);
+Mat4 mat4_rotation_z(float angle) {
+    Mat4 rotation_z_mat = mat4_identity();
 
-    // Deallocate unused matrix
-    DEALLOCATE_MATRICES(rotation_z_mat);
+    MAT4_INDEX(rotation_z_mat, 0, 0) = cosf(deg_to_rad(angle));
+    MAT4_INDEX(rotation_z_mat, 0, 1) = (-sinf(deg_to_rad(angle)));
+    MAT4_INDEX(rotation_z_mat, 1, 0) = sinf(deg_to_rad(angle));
+    MAT4_INDEX(rotation_z_mat, 1, 1) = cosf(deg_to_rad(angle));
 
-    return;
+    return rotation_z_mat;
 }
 
 // Function to create a perspective projection matrix
 // http://www.songho.ca/opengl/gl_projectionmatrix.html
-Matrix perspective_matrix(float fov, float aspect, float near, float far) {
+Mat4 mat4_perspective(float fov, float aspect, float near, float far) {
     assert(aspect != 0.0f);
     assert(far != near);
 
-    Matrix perspective_mat = alloc_matrix(0.0f, 4, 4);
+    Mat4 perspective_mat = {0};
 
     // Calculate the tangent of half the vertical field of view and other parameters
     float tanHalfFov = tanf(deg_to_rad(fov) / 2.0f);
     float zRange = far - near;
 
     // Calculate the values for the projection matrix
-    MAT_INDEX(perspective_mat, 0, 0) =  (1.0f) / (aspect * tanHalfFov);
-    MAT_INDEX(perspective_mat, 1, 1) = (1.0f) / (tanHalfFov);
-    MAT_INDEX(perspective_mat, 2, 2) = -(far + near) / zRange;
-    MAT_INDEX(perspective_mat, 2, 3) = ((-2.0f) * far * near) / zRange;
-    MAT_INDEX(perspective_mat, 3, 2) = -1.0f;
+    MAT4_INDEX(perspective_mat, 0, 0) =  (1.0f) / (aspect * tanHalfFov);
+    MAT4_INDEX(perspective_mat, 1, 1) = (1.0f) / (tanHalfFov);
+    MAT4_INDEX(perspective_mat, 2, 2) = -(far + near) / zRange;
+    MAT4_INDEX(perspective_mat, 2, 3) = ((-2.0f) * far * near) / zRange;
+    MAT4_INDEX(perspective_mat, 3, 2) = -1.0f;
 
     return perspective_mat;
 }
 
-void rotate_matrix(Matrix src, float angle, Vector vec, Matrix* dest) {
-    unsigned int vec_size = VEC_SIZE(vec);
-    assert(vec_size == 3);
+// Rotate mat by angle (radians) around vec, equivalent to mat * R
+Mat4 mat4_rotate(Mat4 mat, float angle, Vec3 vec) {
+    float c = cosf(angle);
+    float s = sinf(angle);
 
-    float a = angle;
-    float c = cosf(a);
-    float s = sinf(a);
+    Vec3 axis = vec3_normalize(vec);
+    Vec3 temp = vec3_scalar_product(axis, (1.0f - c));
 
-    Vector axis = alloc_vector(0.0f, 1);
-    normalize_vector(vec, &axis);
-    Vector temp = alloc_vector(0.0f, 1);
-    scalar_product_matrix(axis, (1.0f - c), &temp);
+    float rotate[3][3];
+    rotate[0][0] = c + VEC_INDEX(temp, 0) * VEC_INDEX(axis, 0);
+    rotate[1][0] = 0 + VEC_INDEX(temp, 0) * VEC_INDEX(axis, 1) + s * VEC_INDEX(axis, 2);
+    rotate[2][0] = 0 + VEC_INDEX(temp, 0) * VEC_INDEX(axis, 2) - s * VEC_INDEX(axis, 1);
 
-    Matrix rotate = alloc_matrix(0.0f, 4, 4);
-    MAT_INDEX(rotate, 0, 0) = c + VEC_INDEX(temp, 0) * VEC_INDEX(axis, 0);
-    MAT_INDEX(rotate, 1, 0) = 0 + VEC_INDEX(temp, 0) * VEC_INDEX(axis, 1) + s * VEC_INDEX(axis, 2);
-    MAT_INDEX(rotate, 2, 0) = 0 + VEC_INDEX(temp, 0) * VEC_INDEX(axis, 2) - s * VEC_INDEX(axis, 1);
+    rotate[0][1] = 0 + VEC_INDEX(temp, 1) * VEC_INDEX(axis, 0) - s * VEC_INDEX(axis, 2);
+    rotate[1][1] = c + VEC_INDEX(temp, 1) * VEC_INDEX(axis, 1);
+    rotate[2][1] = 0 + VEC_INDEX(temp, 1) * VEC_INDEX(axis, 2) + s * VEC_INDEX(axis, 0);
 
-    MAT_INDEX(rotate, 0, 1) = 0 + VEC_INDEX(temp, 1) * VEC_INDEX(axis, 0) - s * VEC_INDEX(axis, 2);
-    MAT_INDEX(rotate, 1, 1) = c + VEC_INDEX(temp, 1) * VEC_INDEX(axis, 1);
-    MAT_INDEX(rotate, 2, 1) = 0 + VEC_INDEX(temp, 1) * VEC_INDEX(axis, 2) + s * VEC_INDEX(axis, 0);
-
-    MAT_INDEX(rotate, 0, 2) = 0 + VEC_INDEX(temp, 2) * VEC_INDEX(axis, 0) + s * VEC_INDEX(axis, 1);
-    MAT_INDEX(rotate, 1, 2) = 0 + VEC_INDEX(temp, 2) * VEC_INDEX(axis, 1) - s * VEC_INDEX(axis, 0);
-    MAT_INDEX(rotate, 2, 2) = c + VEC_INDEX(temp, 2) * VEC_INDEX(axis, 2);
-
-    // Deallocate unused matrices
-    DEALLOCATE_MATRICES(axis, temp);
+    rotate[0][2] = 0 + VEC_INDEX(temp, 2) * VEC_INDEX(axis, 0) + s * VEC_INDEX(axis, 1);
+    rotate[1][2] = 0 + VEC_INDEX(temp, 2) * VEC_INDEX(axis, 1) - s * VEC_INDEX(axis, 0);
+    rotate[2][2] = c + VEC_INDEX(temp, 2) * VEC_INDEX(axis, 2);
 
+    // result[i] = mat[0] * rotate[0][i] + mat[1] * rotate[1][i] + mat[2] * rotate[2][i], result[3] = mat[3]
+    Mat4 result = mat;
+    for (unsigned int row = 0; row < 4; ++row) {
+        for (unsigned int col = 0; col < 3; ++col) {
+            MAT4_INDEX(result, row, col) = MAT4_INDEX(mat, row, 0) * rotate[0][col] + MAT4_INDEX(mat, row, 1) * rotate[1][col] + MAT4_INDEX(mat, row, 2) * rotate[2][col];
+        }
+    }
 
-    Matrix result = alloc_matrix(0.0f, 4, 4);
-    Vector mats[3] = {0};
+    return result;
+}
 
-    for (unsigned int i = 0; i < 3; ++i) {
-        mats[i] = get_col(src, i);
+Mat4 mat4_translate(Mat4 mat, Vec3 vec) {
+    // result[3] = m[0] * v[0] + m[1] * v[1] + m[2] * v[2] + m[3];
+    for (unsigned int row = 0; row < 4; ++row) {
+        MAT4_INDEX(mat, row, 3) += MAT4_INDEX(mat, row, 0) * VEC_INDEX(vec, 0) + MAT4_INDEX(mat, row, 1) * VEC_INDEX(vec, 1) + MAT4_INDEX(mat, row, 2) * VEC_INDEX(vec, 2);
     }
 
-    Vector mat0 = alloc_vector(0.0f, 1);
-    Vector mat1 = alloc_vector(0.0f, 1);
-    Vector mat2 = alloc_vector(0.0f, 1);
-
-    // result[0] = mat0 * MAT_INDEX(rotate, 0, 0) + mat1 * MAT_INDEX(rotate, 1, 0) + mat2 * MAT_INDEX(rotate, 2, 0);
-    scalar_product_matrix(mats[0], MAT_INDEX(rotate, 0, 0), &mat0);
-    scalar_product_matrix(mats[1], MAT_INDEX(rotate, 1, 0), &mat1);
-    scalar_product_matrix(mats[2], MAT_INDEX(rotate, 2, 0), &mat2);
-    SUM_MATRICES(&mat0, mat0, mat1, mat2);
-    copy_vector_to_matrix_col(mat0, result, 0);
-
-    // result[1] = mat0 * MAT_INDEX(*rotate, 0, 1) + mat1 * MAT_INDEX(*rotate, 1, 1) + mat2 * MAT_INDEX(*rotate, 2, 1);
-    scalar_product_matrix(mats[0], MAT_INDEX(rotate, 0, 1), &mat0);
-    scalar_product_matrix(mats[1], MAT_INDEX(rotate, 1, 1), &mat1);
-    scalar_product_matrix(mats[2], MAT_INDEX(rotate, 2, 1), &mat2);
-    SUM_MATRICES(&mat0, mat0, mat1, mat2);
-    copy_vector_to_matrix_col(mat0, result, 1);
-
-    // result[2] = mat0 * MAT_INDEX(*rotate, 0, 2) + mat1 * MAT_INDEX(*rotate, 1, 2) + mat2 * MAT_INDEX(*rotate, 2, 2);
-    scalar_product_matrix(mats[0], MAT_INDEX(rotate, 0, 2), &mat0);
-    scalar_product_matrix(mats[1], MAT_INDEX(rotate, 1, 2), &mat1);
-    scalar_product_matrix(mats[2], MAT_INDEX(rotate, 2, 2), &mat2);
-    SUM_MATRICES(&mat0, mat0, mat1, mat2);
-    copy_vector_to_matrix_col(mat0, result, 2);
-    DEALLOCATE_MATRICES(mat1, mat2);
-
-    // result[3] = get_col(mat, 3);
-    copy_vector_to_matrix_col(get_col(src, 3), result, 3);
-
-    // Deallocate all the unused resources
-    DEALLOCATE_MATRICES(mat0, rotate);
-    gc_dispose();
-
-    // Copy the result matrix
-    copy_matrix(result, dest);
-
-    // Deallocate result matrix
-    DEALLOCATE_MATRICES(result);
+    return mat;
+}
+
+/* MATRIX COMPATIBILITY */
 
+void scale_matrix(Matrix scaling_mat, Vector scaling_vec, Matrix* dest) {
+    mat4_to_matrix(mat4_scale(mat4_from_matrix(scaling_mat), vec3_from_vector(scaling_vec)), 4, dest);
     return;
 }
 
-void translate_mat(Matrix src, Vector vec, Matrix* dest) {
-    Matrix temp = alloc_matrix(0.0f, 1, 1);
-    copy_matrix(src, &temp);
-
-    Vector mat0 = alloc_vector(0.0f, 1);
-    Vector mat1 = alloc_vector(0.0f, 1);
-    Vector mat2 = alloc_vector(0.0f, 1);
+void rotation_x_matrix(float angle, int size, Matrix* dest) {
+    mat4_to_matrix(mat4_rotation_x(angle), size, dest);
+    return;
+}
 
-    // result[3] = m[0] * v[0] + m[1] * v[1] + m[2] * v[2] + m[3];
-    scalar_product_matrix(get_col(src, 0), VEC_INDEX(vec, 0), &mat0);
-    scalar_product_matrix(get_col(src, 1), VEC_INDEX(vec, 1), &mat1);
-    scalar_product_matrix(get_col(src, 2), VEC_INDEX(vec, 2), &mat2);
-    SUM_MATRICES(&mat0, mat0, mat1, mat2, get_col(src, 3));
-    copy_vector_to_matrix_col(mat0, temp, 3);
+void rotation_y_matrix(float angle, int size, Matrix* dest) {
+    mat4_to_matrix(mat4_rotation_y(angle), size, dest);
+    return;
+}
 
-    // Deallocate all the unused resources
-    DEALLOCATE_MATRICES(mat0, mat1, mat2);
-    gc_dispose();
+void rotation_z_matrix(float angle, int size, Matrix* dest) {
+    mat4_to_matrix(mat4_rotation_z(angle), size, dest);
+    return;
+}
 
-    // Copy the result
-    copy_matrix(temp, dest);
+Matrix perspective_matrix(float fov, float aspect, float near, float far) {
+    return matrix_from_mat4(mat4_perspective(fov, aspect, near, far));
+}
 
-    // Deallocate temp matrix
-    DEALLOCATE_MATRICES(temp);
+void rotate_matrix(Matrix src, float angle, Vector vec, Matrix* dest) {
+    assert(VEC_SIZE(vec) == 3);
+    mat4_to_matrix(mat4_rotate(mat4_from_matrix(src), angle, vec3_from_vector(vec)), 4, dest);
+    return;
+}
 
+void translate_mat(Matrix src, Vector vec, Matrix* dest) {
+    mat4_to_matrix(mat4_translate(mat4_from_matrix(src), vec3_from_vector(vec)), 4, dest);
     return;
 }
 
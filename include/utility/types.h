@@ -16,6 +16,9 @@ typedef struct ImageFile {
     Image image;
 } ImageFile;
 
+// The value of each texture type is also the texture unit its sampler is bound to
+typedef enum TextureType { BASE_COLOR_TEXTURE, METALLIC_ROUGHNESS_TEXTURE, NORMAL_TEXTURE, OCCLUSION_TEXTURE, EMISSIVE_TEXTURE, TEXTURE_TYPES_COUNT } TextureType;
+
 typedef struct TextureParams {
     unsigned short int mag_filter;
     unsigned short int min_filter;
@@ -32,11 +35,25 @@ typedef struct Matrix {
 typedef Matrix Vector;
 typedef Matrix Quaternion;
 
+// Fixed-size value types, passed by value and never heap allocated
+typedef struct Vec3 {
+    float data[3];
+} Vec3;
+
+typedef struct Vec4 {
+    float data[4];
+} Vec4;
+
+typedef struct Mat4 {
+    float data[16];
+} Mat4;
+
+typedef Vec4 Quat;
+
 typedef struct Camera {
-    Vector camera_pos;
-    Vector camera_front;
-    Vector camera_up;
+    Vec3 camera_pos;
+    Vec3 camera_front;
+    Vec3 camera_up;
     float camera_speed;
 } Camera;
-
 #endif //_TYPES_H_
@@ -6,6 +6,8 @@
 #include <math.h>
 #include <stdarg.h>
 #include <string.h>
+#include <time.h>
+#include <sys/resource.h>
 #include "../glad/glad.h"
 #include "./types.h"
 
@@ -54,34 +56,6 @@ char* get_directory(char* path) {
     return directory;
 }
 
-void set_int(unsigned int shader, const char* obj_name, int obj_data, void (*uniform_value)(GLint, GLint)) {
-    glUseProgram(shader);
-    unsigned int object = glGetUniformLocation(shader, obj_name);
-    (*uniform_value)(object, obj_data);
-    return;
-}
-
-void set_vec(unsigned int shader, const char* obj_name, float* obj_data, void (*uniform_vec)(GLint, GLsizei, const GLfloat*)) {
-    glUseProgram(shader);
-    unsigned int object = glGetUniformLocation(shader, obj_name);
-    (*uniform_vec)(object, 1, obj_data);
-    return;
-}
-
-void set_float(unsigned int shader, const char* obj_name, float obj_data, void (*uniform_value)(GLint, GLfloat)) {
-    glUseProgram(shader);
-    unsigned int object = glGetUniformLocation(shader, obj_name);
-    (*uniform_value)(object, obj_data);
-    return;
-}
-
-void set_matrix(unsigned int shader, const char* obj_name, float* obj_data, void (*uniform_mat)(GLint, GLsizei, GLboolean, const GLfloat*)) {
-    glUseProgram(shader);
-    unsigned int object = glGetUniformLocation(shader, obj_name);
-    (*uniform_mat)(object, 1, GL_TRUE, obj_data);
-    return;
-}
-
 float absf(float val) {
     return val < 0.0f ? -val : val;
 }
@@ -167,6 +141,34 @@ void concat(unsigned int count, char** str, const char* format, ...) {
     return;
 }
 
+#define FNV1A_OFFSET_BASIS 14695981039346656037ULL
+#define FNV1A_PRIME 1099511628211ULL
+
+// 64 bit FNV-1a, chain calls by passing the previous hash as seed (FNV1A_OFFSET_BASIS to start)
+unsigned long long int fnv1a_hash(const void* data, size_t size, unsigned long long int seed) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    unsigned long long int hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+// Seconds from an arbitrary origin, usable without a window unlike glfwGetTime
+double get_wall_time(void) {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// Highest resident set size of the process so far, in MB
+double get_peak_rss(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) return 0.0;
+    return usage.ru_maxrss / 1024.0;
+}
+
 bool str_contains(char* str, char* sub_str) {
     unsigned int str_len = strlen(str);
     unsigned int sub_str_len = strlen(sub_str);
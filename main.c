@@ -7,7 +7,35 @@
 #include "./include/utility/loader.h"
 #include "./include/utility/render.h"
 
-int main(void) {
+int main(int argc, char** argv) {
+#ifdef _SIMD_BENCHMARK_
+    // Micro-benchmark of the matrix kernels, the whole binary is built for it (make simd_benchmark)
+    benchmark_simd_kernels();
+    return 0;
+#endif
+
+    // Build the texture caches of a model without opening a window, add --compress-textures to warm the compressed ones
+    if ((argc == 3 || argc == 4) && !strcmp(argv[1], "--warm-cache")) {
+        bool compress = argc == 4 && !strcmp(argv[3], "--compress-textures");
+        warm_model_textures(argv[2], compress);
+        deallocate_worker_pool();
+        return 0;
+    }
+
+    // Check the mip generator against its scalar reference, on an image or on a generated one
+    if ((argc == 2 || argc == 3) && !strcmp(argv[1], "--verify-mips")) {
+        bool is_exact = verify_mip_chain(argc == 3 ? argv[2] : NULL);
+        deallocate_worker_pool();
+        return is_exact ? 0 : 1;
+    }
+
+    // Compare the block compression formats on an image, also without a window
+    if (argc == 3 && !strcmp(argv[1], "--benchmark-compression")) {
+        benchmark_texture_compression(argv[2]);
+        deallocate_worker_pool();
+        return 0;
+    }
+
     // Init the window and check the status of the operation
     GLFWwindow* window;
     if ((window = init_window(WIDTH, HEIGHT, "Game")) == NULL) {
@@ -15,22 +43,39 @@ int main(void) {
     }
 
     debug_info("Loaded window\n");
+    debug_info("Using %s matrix kernels\n", simd_kernels_name());
+
+    // Runtime options, they can be combined
+    unsigned long long int frames_limit = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--compress-textures")) enable_texture_compression();
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) frames_limit = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--no-program-cache")) disable_program_cache();
+        else if (!strcmp(argv[i], "--profile")) enable_profiler();
+    }
 
-    // Init the shaders and check the status of the operation
-    unsigned int vertex_shader;
-    if ((vertex_shader = init_shaders((const char*) "./include/shaders/vertex.glsl", (const char*) "./include/shaders/fragment.glsl")) == INT32_MAX) {
+    // Init the shaders and check the status of the operation, the other variants are built as the materials need them
+    double shaders_start_time = glfwGetTime();
+    ShaderVariants shaders;
+    if (!init_shader_variants(&shaders, "./include/shaders/vertex.glsl", "./include/shaders/fragment.glsl")) {
         return -1;
     }
 
-    debug_info("Loaded shader program\n");
+    debug_info("Loaded shader programs in %.2f ms (program cache %s)\n", (glfwGetTime() - shaders_start_time) * 1000.0, is_program_cache_enabled() ? "enabled" : "disabled");
 
     debug_info("Rendering...\n");
 
-    render(window, vertex_shader);
+    bool is_model_ready = render(window, &shaders, frames_limit);
 
     debug_info("terminating the program...\n");
 
-    terminate(vertex_shader);
+    terminate(&shaders);
+
+    // A run with a frame limit is a check (make check_allocations), it fails when the model never became resident
+    if (frames_limit && !is_model_ready) {
+        error_info("the model was not resident after %llu frames\n", frames_limit);
+        return 1;
+    }
 
     return 0;
 }